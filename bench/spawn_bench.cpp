@@ -0,0 +1,144 @@
+/********************************************************
+ * Description : spawn latency benchmark of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+/*
+ * compare fork() + execv() (the old create_process) with spawn_process()
+ * while the benchmark itself holds different amounts of resident memory
+ *
+ * usage: spawn_bench [count] [rss_mb ...]
+ *        spawn_bench 200 0 256 1024 (default)
+ */
+
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "process_launcher.h"
+
+static const char * s_file = "/bin/true";
+
+static double now_microseconds()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<double>(ts.tv_sec) * 1000000.0 + static_cast<double>(ts.tv_nsec) / 1000.0;
+}
+
+static bool fork_once()
+{
+    const char * argv[] = { s_file, nullptr };
+
+    pid_t pid = ::fork();
+    if (pid < 0)
+    {
+        return false;
+    }
+    else if (0 == pid)
+    {
+        ::execv(argv[0], const_cast<char **>(argv));
+        ::_exit(127);
+    }
+
+    return ::waitpid(pid, nullptr, 0) == pid;
+}
+
+static bool spawn_once()
+{
+    const char * argv[] = { s_file, nullptr };
+
+    SpawnAttributes attributes;
+    attributes.file = argv[0];
+    attributes.argv = const_cast<char * const *>(argv);
+    attributes.envp = nullptr;
+    attributes.work_directory = "/";
+    attributes.close_stdio = true;
+    attributes.new_process_group = false;
+    attributes.cgroup_procs_fd = -1;
+    attributes.limits = nullptr;
+    attributes.limit_count = 0;
+    attributes.limits_in_cgroup = false;
+    attributes.scheduling = nullptr;
+
+    SpawnResult result;
+    if (!spawn_process(attributes, result))
+    {
+        return false;
+    }
+
+    pid_t pid = static_cast<pid_t>(result.pid);
+    return ::waitpid(pid, nullptr, 0) == pid;
+}
+
+static double measure(bool (*launch)(), size_t count)
+{
+    double begin = now_microseconds();
+    for (size_t index = 0; index < count; ++index)
+    {
+        if (!launch())
+        {
+            printf("launch %s failed\n", s_file);
+            return -1.0;
+        }
+    }
+    return (now_microseconds() - begin) / static_cast<double>(count);
+}
+
+int main(int argc, char * argv[])
+{
+    size_t count = 200;
+    if (argc > 1)
+    {
+        count = static_cast<size_t>(atoi(argv[1]));
+    }
+
+    std::vector<size_t> rss_list;
+    for (int index = 2; index < argc; ++index)
+    {
+        rss_list.push_back(static_cast<size_t>(atoi(argv[index])));
+    }
+    if (rss_list.empty())
+    {
+        rss_list.push_back(0);
+        rss_list.push_back(256);
+        rss_list.push_back(1024);
+    }
+
+    printf("%10s %16s %16s\n", "rss(MB)", "fork(us)", "spawn(us)");
+
+    for (std::vector<size_t>::const_iterator iter = rss_list.begin(); rss_list.end() != iter; ++iter)
+    {
+        const size_t rss_size = *iter * 1024 * 1024;
+        char * memory = nullptr;
+        if (rss_size > 0)
+        {
+            memory = reinterpret_cast<char *>(::malloc(rss_size));
+            if (nullptr == memory)
+            {
+                printf("malloc %u MB failed\n", static_cast<unsigned int>(*iter));
+                continue;
+            }
+            memset(memory, 0x5a, rss_size); /* make it resident */
+        }
+
+        double fork_cost = measure(fork_once, count);
+        double spawn_cost = measure(spawn_once, count);
+
+        printf("%10u %16.1f %16.1f\n", static_cast<unsigned int>(*iter), fork_cost, spawn_cost);
+
+        ::free(memory);
+    }
+
+    return 0;
+}
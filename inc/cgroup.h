@@ -0,0 +1,84 @@
+/********************************************************
+ * Description : cgroup v2 of daemon services
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifndef DAEMON_CGROUP_H
+#define DAEMON_CGROUP_H
+
+
+#include <map>
+#include <set>
+#include <string>
+#include "base/utility/uncopy.h"
+
+/*
+ * linux only, every service runs in its own leaf cgroup:
+ *     <cgroup of the daemon>/daemon.services/<service>
+ * so the whole process tree of a service can be signaled at once
+ * (cgroup.kill), and "populated 0" of cgroup.events tells when it is empty,
+ * cgroup.events of every leaf is in one epoll set (EPOLLPRI on change)
+ *
+ * if there is no cgroup v2 hierarchy, or it is not writable,
+ * is_available() is false and the caller uses the process group only
+ *
+ * resource limits are the interface files of the leaf, written as they are:
+ *     memory.max, memory.high, cpu.max, cpu.weight, io.weight, pids.max
+ * a controller is enabled in daemon.services (and in the cgroup of the daemon
+ * if needed) when the first limit of it is set, a file which is not given
+ * is set back to its default, so a limit removed from the config is lifted
+ */
+typedef std::map<std::string, std::string> cgroup_limits_t;
+
+class CgroupManager : private Stupid::Base::Uncopy
+{
+public:
+    CgroupManager();
+    ~CgroupManager();
+
+public:
+    bool init();
+    void exit();
+    bool is_available() const;
+
+public:
+    bool create(const std::string & cgroup_name);
+    bool set_limits(const std::string & cgroup_name, const cgroup_limits_t & limits);
+    int procs_fd(const std::string & cgroup_name) const;
+    std::string path(const std::string & cgroup_name) const;
+    bool is_populated(const std::string & cgroup_name) const;
+    bool signal(const std::string & cgroup_name, int signo);
+    bool kill(const std::string & cgroup_name);
+    void update();
+    int event_fd() const;   /* readable when a cgroup.events changes, -1 if unavailable */
+
+private:
+    struct CgroupInfo
+    {
+        std::string   path;
+        int           procs_fd;     /* cgroup.procs, written by the spawned child   */
+        int           events_fd;    /* cgroup.events, in the epoll set              */
+        bool          populated;
+    };
+
+private:
+    static bool read_populated(int events_fd, bool & populated);
+    bool enable_controller(const std::string & controller);
+
+private:
+    bool                                    m_available;
+    std::string                             m_parent_path;  /* cgroup of the daemon         */
+    std::string                             m_root_path;
+    std::set<std::string>                   m_controllers;  /* enabled in daemon.services   */
+    int                                     m_epoll_fd;
+    std::map<std::string, CgroupInfo>       m_cgroup_map;
+};
+
+
+#endif // DAEMON_CGROUP_H
@@ -0,0 +1,83 @@
+/********************************************************
+ * Description : check scheduler of daemon services
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifndef DAEMON_CHECK_SCHEDULER_H
+#define DAEMON_CHECK_SCHEDULER_H
+
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "base/utility/uncopy.h"
+
+/*
+ * when each service is checked next, on a min-heap of due times
+ * (monotonic nanoseconds, see get_monotonic_nanoseconds):
+ * next_due_time() is the top of the heap, so a tick with nothing due
+ * costs the same for ten services or ten thousand, and take_due() pops
+ * only the services which are due
+ *
+ * a service is due once: take_due() forgets it (and tells when it was due,
+ * which the next due time is counted from), and it is not checked
+ * again unless it is scheduled again, so a service which is gone from
+ * the config just drops out
+ *
+ * schedule() of a service which is in the heap already leaves the old
+ * entry behind as stale, it is skipped when it comes to the top,
+ * and the heap is rebuilt when stale entries are the most of it
+ */
+class CheckScheduler : private Stupid::Base::Uncopy
+{
+public:
+    struct DueTask
+    {
+        std::string   key;
+        uint64_t      due_time;
+    };
+
+public:
+    CheckScheduler();
+
+public:
+    void clear();
+    void schedule(const std::string & key, uint64_t due_time);
+    bool has(const std::string & key) const;
+    uint64_t next_due_time();               /* UINT64_MAX if nothing is scheduled */
+    void take_due(uint64_t now, std::vector<DueTask> & due_list);
+    size_t size() const;
+
+public:
+    /* a random delay in [0, range], to spread the checks of services with the same interval */
+    uint64_t jitter(uint64_t range);
+
+private:
+    struct Task
+    {
+        uint64_t      due_time;
+        uint64_t      sequence;     /* the task is stale if the key is scheduled again */
+        std::string   key;
+    };
+
+private:
+    static bool task_later(const Task & lhs, const Task & rhs);
+    void pop_stale();
+    void rebuild();
+
+private:
+    std::vector<Task>                       m_task_heap;
+    std::map<std::string, uint64_t>         m_sequence_map; /* the live sequence of every key */
+    uint64_t                                m_sequence;
+    uint64_t                                m_random;
+};
+
+
+#endif // DAEMON_CHECK_SCHEDULER_H
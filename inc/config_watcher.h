@@ -0,0 +1,53 @@
+/********************************************************
+ * Description : config watcher of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifndef DAEMON_CONFIG_WATCHER_H
+#define DAEMON_CONFIG_WATCHER_H
+
+
+#include <string>
+#include <vector>
+#include "base/utility/uncopy.h"
+
+/*
+ * tells when a file of a directory is written, linux only (inotify):
+ * the directory is watched, not the file, so an editor which writes
+ * a new file and renames it over the old one is seen too
+ * (IN_CLOSE_WRITE for a write in place, IN_MOVED_TO for a rename)
+ */
+class ConfigWatcher : private Stupid::Base::Uncopy
+{
+public:
+    ConfigWatcher();
+    ~ConfigWatcher();
+
+public:
+    bool init(const std::string & directory, const std::string & file_name);
+    void exit();
+    bool is_open() const;
+    int event_fd() const;
+
+public:
+    /*
+     * read all pending events without blocking,
+     * return true if the file was written (or events were lost)
+     */
+    bool update();
+
+private:
+    int                                     m_inotify_fd;
+    int                                     m_watch_fd;
+    std::string                             m_file_name;
+    std::vector<char>                       m_buffer;
+};
+
+
+#endif // DAEMON_CONFIG_WATCHER_H
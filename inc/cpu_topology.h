@@ -0,0 +1,64 @@
+/********************************************************
+ * Description : cpu topology of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifndef DAEMON_CPU_TOPOLOGY_H
+#define DAEMON_CPU_TOPOLOGY_H
+
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+ * the kernel list format: "0-3,8,10-11", the result is sorted and unique,
+ * a number of CPU_SETSIZE or more fails the whole list
+ */
+extern bool parse_cpu_list(const std::string & text, std::vector<size_t> & list);
+
+/*
+ * read Cpus_allowed_list of /proc/<pid>/status
+ */
+extern bool get_process_cpus(size_t process_id, std::vector<size_t> & cpus);
+
+/*
+ * linux only, the online cpus with their numa node and core,
+ * read once from /sys/devices/system/cpu and /sys/devices/system/node
+ *
+ * a cpu spec is a comma separated list of items, the result is their union:
+ *     3, 4-7         cpus by number
+ *     node 1         every cpu of numa node 1 (or nodes: node 0-1)
+ *     physical       keep the first hardware thread of every core only
+ * so "node 1, physical" is one thread of every core of node 1
+ */
+class CpuTopology
+{
+public:
+    CpuTopology();
+
+public:
+    bool load();
+    bool empty() const;
+    bool resolve(const std::string & cpu_spec, std::vector<size_t> & cpus) const;
+
+private:
+    struct CpuInfo
+    {
+        size_t        cpu;
+        size_t        node;
+        bool          primary;      /* the first thread of its core */
+    };
+
+private:
+    std::vector<CpuInfo>            m_cpu_list;
+};
+
+
+#endif // DAEMON_CPU_TOPOLOGY_H
@@ -13,12 +13,32 @@
 #define DAEMON_DAEMON_H
 
 
+#ifndef _MSC_VER
+    #include <pthread.h>
+#endif // _MSC_VER
+
 #include <cstdint>
 #include <string>
 #include <map>
+#include <set>
 #include "base/time/single_timer.h"
 #include "base/utility/uncopy.h"
 #include "base/utility/singleton.h"
+#include "process_table.h"
+#include "process_watcher.h"
+#include "process_stopper.h"
+#include "cgroup.h"
+#include "resource_sampler.h"
+#include "probe_engine.h"
+#include "endpoint_resolver.h"
+#include "listen_table.h"
+#include "check_scheduler.h"
+#include "event_loop.h"
+#include "config_watcher.h"
+#include "process_launcher.h"
+
+struct ServiceInfo;
+struct ServiceTable;
 
 class Daemon : public Stupid::Base::ISingleTimerSink, private Stupid::Base::Uncopy
 {
@@ -39,18 +59,68 @@ private:
 private:
     struct ProcessInfo
     {
-        size_t        id;
-        std::string   name;
+        PROCESS_IDENTITY    identity;
+        LaunchSpec          launch_spec;
+        bool                show;
+        std::string         cgroup;         /* leaf cgroup name of the service     */
+        bool                in_cgroup;      /* false: the process group only       */
+        uint64_t            stop_timeout;   /* seconds from SIGTERM to SIGKILL     */
+        cgroup_limits_t     limits;         /* written to the leaf cgroup          */
+        uint64_t            start_time;     /* monotonic nanoseconds               */
     };
 
+    struct ProbeCheck
+    {
+        std::vector<std::string>    ports;
+        std::vector<size_t>         probe_ids;      /* of the ports, in the same order     */
+    };
+
+private:
+    bool start_service(const std::string & cmdl, ProcessInfo process_info);
+    void check_exited_services();
+    void check_died_services();
+    void on_service_exit(const ProcessExit & process_exit);
+    void on_service_stopped(size_t process_id);
+    void reload_services();
+    void install_services(ServiceTable * service_table, uint64_t config_hash);
+    void check_services(uint64_t now);
+    void check_probes();
+    void schedule_restart(const std::string & cmdl, uint64_t start_time);
+    void restart_service(const ServiceInfo & service_info);
+    uint64_t next_event_time();     /* monotonic nanoseconds */
+    uint64_t next_check_time(const std::string & key, uint64_t due_time, uint64_t interval, uint64_t now);
+#ifndef _MSC_VER
+    static void * event_loop_thread(void * argument);
+#endif // _MSC_VER
+
 private:
     volatile bool                        m_running;
     std::string                          m_root_directory;
     std::string                          m_record_file;
-    uint64_t                             m_last_check_time;
-    uint64_t                             m_check_interval;
+    const ServiceTable                 * m_service_table;
+    uint64_t                             m_config_hash;      /* of the text m_service_table is loaded from */
+    ConfigWatcher                        m_config_watcher;
+    CheckScheduler                       m_check_scheduler;  /* monotonic nanoseconds */
+    std::map<std::string, uint64_t>      m_check_overrun_map;/* periods missed by each service so far */
+    std::map<std::string, uint64_t>      m_restart_delay_map;/* the last restart delay of each service */
+    std::set<std::string>                m_restart_set;      /* the services which wait for their restart */
     std::map<std::string, ProcessInfo>   m_process_info_map;
+    ProcessSnapshot                      m_process_snapshot;
+    ProcessWatcher                       m_process_watcher;
+    CgroupManager                        m_cgroup_manager;
+    ProcessStopper                       m_process_stopper;
+    ResourceSampler                      m_resource_sampler;
+    ProbeEngine                          m_probe_engine;
+    std::map<std::string, ProbeCheck>    m_probe_check_map;  /* the checks which wait for their probes */
+    EndpointResolver                     m_endpoint_resolver;
+    ListenTable                          m_listen_table;
+#ifdef _MSC_VER
     Stupid::Base::SingleTimer            m_check_timer;
+#else
+    EventLoop                            m_event_loop;
+    pthread_t                            m_event_thread;
+    bool                                 m_event_thread_started;
+#endif // _MSC_VER
 };
 
 
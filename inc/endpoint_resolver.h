@@ -0,0 +1,103 @@
+/********************************************************
+ * Description : endpoint resolver of daemon services
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifndef DAEMON_ENDPOINT_RESOLVER_H
+#define DAEMON_ENDPOINT_RESOLVER_H
+
+
+#include "net/common/common.h"
+
+#ifndef _MSC_VER
+    #include <netdb.h>
+    #include <sys/socket.h>
+#endif // _MSC_VER
+
+#include <cstdint>
+#include <map>
+#include <list>
+#include <deque>
+#include <string>
+#include "base/utility/uncopy.h"
+
+struct Endpoint
+{
+    std::string                 host;
+    std::string                 port;
+    std::string                 key;            /* "host:port"                   */
+    struct sockaddr_storage     address;
+    uint32_t                    address_size;   /* 0 if the host is not resolved */
+};
+
+/*
+ * the address of every "host:port" a service is probed on:
+ * get() resolves a new endpoint at once (the config is being loaded then),
+ * and returns the same endpoint for the life of the resolver,
+ * so a probe only connect()s to endpoint.address, no name is looked up
+ *
+ * a numeric host and port is never resolved again,
+ * a named one is refreshed every ttl by update(), in the background
+ * (getaddrinfo_a), and keeps its last good address while it is refreshed
+ * or if the refresh fails, a finished refresh makes event_fd() readable
+ *
+ * on windows, the address is resolved once and never refreshed
+ */
+class EndpointResolver : private Stupid::Base::Uncopy
+{
+public:
+    EndpointResolver();
+    ~EndpointResolver();
+
+public:
+    bool init(uint64_t ttl_ms);
+    void exit();
+
+public:
+    const Endpoint & get(const std::string & host, const std::string & port);
+    void update(uint64_t now_ms);
+    uint64_t next_expire_time() const;
+    int event_fd() const;   /* readable when a refresh is done, -1 on windows */
+
+private:
+    struct Entry
+    {
+        Endpoint      endpoint;
+        bool          numeric;
+        bool          pending;      /* a refresh is running */
+        uint64_t      expire_time;
+    };
+
+#ifndef _MSC_VER
+    struct Request
+    {
+        size_t              index;
+        struct addrinfo     hints;
+        struct gaicb        control;
+    };
+#endif // _MSC_VER
+
+private:
+    static bool resolve(Endpoint & endpoint, bool numeric);
+    void collect(uint64_t now_ms);
+    void refresh(Entry & entry, size_t index, uint64_t now_ms);
+
+private:
+    uint64_t                                m_ttl_ms;
+    uint64_t                                m_next_expire_time;
+    int                                     m_event_fd;
+    std::deque<Entry>                       m_entry_list;   /* never shrinks, endpoints stay put */
+    std::map<std::string, size_t>           m_entry_map;
+#ifndef _MSC_VER
+    std::list<Request>                      m_request_list;
+#endif // _MSC_VER
+};
+
+
+#endif // DAEMON_ENDPOINT_RESOLVER_H
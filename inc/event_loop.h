@@ -0,0 +1,57 @@
+/********************************************************
+ * Description : event loop of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifndef DAEMON_EVENT_LOOP_H
+#define DAEMON_EVENT_LOOP_H
+
+
+#include <cstdint>
+#include "base/utility/uncopy.h"
+
+/*
+ * one epoll set which the daemon thread sleeps on, linux only:
+ * the pollable fds of the other parts (epoll sets of the process watcher,
+ * the cgroup manager and the probe engine, the process event stream,
+ * the resolver eventfd) are added to it, and wait() returns when one
+ * of them is readable, when the deadline is passed (a timerfd on
+ * CLOCK_MONOTONIC, armed with the absolute deadline), or on wake(),
+ * so the thread does not wake up while nothing is due
+ *
+ * the fds are level-triggered, the owner must read them empty
+ */
+class EventLoop : private Stupid::Base::Uncopy
+{
+public:
+    EventLoop();
+    ~EventLoop();
+
+public:
+    bool init();
+    void exit();
+
+public:
+    bool add(int fd);
+    void remove(int fd);
+    bool wait(uint64_t deadline_ns);    /* monotonic nanoseconds, UINT64_MAX for none */
+    void wake();                        /* from any thread */
+
+private:
+    bool arm(uint64_t deadline_ns);
+
+private:
+    int                                     m_epoll_fd;
+    int                                     m_timer_fd;
+    int                                     m_wake_fd;
+    uint64_t                                m_armed_deadline;
+};
+
+
+#endif // DAEMON_EVENT_LOOP_H
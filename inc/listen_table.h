@@ -0,0 +1,73 @@
+/********************************************************
+ * Description : listen socket table of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifndef DAEMON_LISTEN_TABLE_H
+#define DAEMON_LISTEN_TABLE_H
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "base/utility/uncopy.h"
+
+/*
+ * every tcp LISTEN socket of the host, linux only:
+ * refresh() dumps them with one NETLINK_SOCK_DIAG request per address family
+ * (inet and inet6), so a local service is checked by looking its port up,
+ * without a connect() to it
+ *
+ * a port is listening for a host if a socket is bound to the address
+ * of the host, or to the wildcard address of either family
+ */
+class ListenTable : private Stupid::Base::Uncopy
+{
+public:
+    ListenTable();
+    ~ListenTable();
+
+public:
+    bool init();
+    void exit();
+    bool is_open() const;
+    bool refresh();
+
+public:
+    /* the socket inode of the listener is returned, 0 if not listening */
+    uint64_t find(const std::string & host, const std::string & port) const;
+
+public:
+    static bool is_local_host(const std::string & host);
+
+    /* true if one of the open files of the process is socket:[inode] */
+    static bool process_has_socket(size_t process_id, uint64_t inode);
+
+private:
+    struct Entry
+    {
+        uint16_t      port;
+        uint8_t       family;       /* AF_INET or AF_INET6          */
+        uint8_t       address[16];  /* network order, 4 for AF_INET */
+        uint64_t      inode;
+    };
+
+private:
+    static bool entry_port_less(const Entry & lhs, const Entry & rhs);
+    bool dump(int family);
+
+private:
+    int                                     m_socket;
+    uint32_t                                m_sequence;
+    std::vector<char>                       m_buffer;
+    std::vector<Entry>                      m_entry_list;   /* sorted by port */
+};
+
+
+#endif // DAEMON_LISTEN_TABLE_H
@@ -0,0 +1,152 @@
+/********************************************************
+ * Description : probe engine of daemon services
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifndef DAEMON_PROBE_ENGINE_H
+#define DAEMON_PROBE_ENGINE_H
+
+
+#include <cstdint>
+#include <map>
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+#include "base/utility/uncopy.h"
+#include "endpoint_resolver.h"
+
+/*
+ * the probes of the checks run in the background of the daemon thread:
+ * add() starts a probe at once as a non-blocking connect to the resolved
+ * address of its endpoint, on one epoll set (probe_fd(), in the event loop
+ * of the daemon), update() moves the probes on when their sockets are
+ * ready and fails the ones past their own deadline (next_deadline()),
+ * so no check waits for a probe, and every probe of a service runs at
+ * the same time, a check takes as long as its slowest probe
+ *
+ * at most max_inflight sockets are open at once, the rest start as slots free,
+ * a probe is kept until remove(), is_done() tells when it has its result
+ *
+ * a persistent probe keeps its connection after it succeeds, and is ok
+ * at once in the next checks while the connection is up, every kept
+ * connection is in a second epoll set (EPOLLRDHUP, and tcp keepalive for
+ * a peer which is gone silently), update() reports the dropped ones,
+ * so a service death is seen without waiting for the next check;
+ * a kept connection stays open between checks (most checks are of
+ * other services), it is closed by retain() when no service of the
+ * config probes its endpoint any more, by release() when its service
+ * is checked without a probe, or when its service probes it in another way
+ *
+ * an http probe sends "GET <path>" once connected, and is ok if the
+ * response has the expected status and the body has the expected text,
+ * it runs on the same epoll set and deadline as the connect,
+ * a connection the server keeps alive (HTTP/1.1) waits in an idle pool
+ * for the next check, and a reused connection which the server has
+ * closed meanwhile is connected again once, within the same deadline
+ *
+ * sockets are closed with SO_LINGER 0 (RST), no TIME_WAIT is left behind
+ *
+ * on windows, add() connects the probe at once (blocking),
+ * where an http probe is a plain connect
+ */
+class ProbeEngine : private Stupid::Base::Uncopy
+{
+public:
+    ProbeEngine();
+    ~ProbeEngine();
+
+public:
+    bool init(size_t max_inflight = 512);
+    void exit();
+
+public:
+    size_t add(const Endpoint & endpoint, uint64_t timeout_ms, bool persistent); /* returns the probe id */
+    size_t add_http(const Endpoint & endpoint, uint64_t timeout_ms, const std::string & path, int expect_status, const std::string & expect_body);
+    void remove(size_t probe_id);                           /* a running probe is cancelled */
+    void retain(const std::set<std::string> & key_set);    /* close the kept connections of other "host:port" */
+    void release(const std::string & key);                  /* close the kept connections of "host:port" */
+    void update(std::vector<std::string> & dropped_list); /* "host:port" of the dropped connections */
+    uint64_t next_deadline() const; /* monotonic milliseconds, UINT64_MAX if no probe is running */
+    int probe_fd() const;   /* readable when a running probe can go on */
+    int event_fd() const;   /* readable when a kept connection is dropped */
+    bool is_done(size_t probe_id) const;
+    bool is_ok(size_t probe_id) const;
+    int error(size_t probe_id) const;   /* errno of a failed probe, ETIMEDOUT if past its deadline */
+                                        /* EADDRNOTAVAIL if the endpoint is not resolved         */
+                                        /* EPROTO if the http response is not the expected one   */
+    int http_status(size_t probe_id) const; /* 0 if no response */
+
+private:
+    enum ProbeState
+    {
+        probe_queued,
+        probe_connecting,   /* connecting, sending and receiving are in the epoll set */
+        probe_sending,
+        probe_receiving,
+        probe_ok,
+        probe_failed
+    };
+
+    struct Probe
+    {
+        size_t        id;
+        const Endpoint * endpoint;      /* owned by the EndpointResolver */
+        uint64_t      timeout_ms;
+        uint64_t      deadline;
+        int           fd;
+        bool          persistent;
+        ProbeState    state;
+        int           error;
+        bool          http;
+        bool          reused;       /* the connection is from the idle pool */
+        std::string   request;
+        size_t        sent;
+        std::string   response;
+        int           expect_status;
+        std::string   expect_body;
+        int           status;
+        bool          keep_alive;   /* the response may be followed by another one */
+    };
+
+    struct Connection
+    {
+        int           fd;
+    };
+
+private:
+    static void close_socket(int fd);
+    static bool is_active(const Probe & probe);
+    static void init_probe(Probe & probe, const Endpoint & endpoint, uint64_t timeout_ms, bool persistent);
+    size_t submit(const Probe & probe);
+    void start_queued(uint64_t now_ms);
+    bool start(Probe & probe, size_t probe_id, uint64_t now_ms);
+    bool connect(Probe & probe, size_t probe_id);
+    void advance(Probe & probe, size_t probe_id, uint32_t events);
+    void receive(Probe & probe, size_t probe_id);
+    bool retry(Probe & probe, size_t probe_id);
+    void finish(Probe & probe, int error);
+    void keep(Probe & probe);
+    void keep_idle(Probe & probe);
+
+private:
+    int                                     m_epoll_fd;
+    int                                     m_watch_fd;     /* kept connections      */
+    std::map<std::string, Connection>       m_connection_map;
+    std::map<std::string, Connection>       m_idle_map;     /* http keep-alive       */
+    size_t                                  m_max_inflight;
+    size_t                                  m_inflight;
+    size_t                                  m_last_probe_id;
+    std::map<size_t, Probe>                 m_probe_map;
+    std::deque<size_t>                      m_probe_queue;  /* waiting for a slot    */
+    std::set<std::pair<uint64_t, size_t> >  m_deadline_set; /* of the running probes */
+};
+
+
+#endif // DAEMON_PROBE_ENGINE_H
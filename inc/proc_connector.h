@@ -0,0 +1,63 @@
+/********************************************************
+ * Description : process event stream of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifndef DAEMON_PROC_CONNECTOR_H
+#define DAEMON_PROC_CONNECTOR_H
+
+
+#include <vector>
+#include "base/utility/uncopy.h"
+
+struct ProcEvent
+{
+    enum event_type_t
+    {
+        fork_event,
+        exec_event,
+        exit_event
+    };
+
+    event_type_t  type;
+    size_t        pid;  /* thread group id, threads are filtered out */
+};
+
+/*
+ * fork/exec/exit events of all processes from the kernel
+ * (NETLINK_CONNECTOR, CN_IDX_PROC), needs CAP_NET_ADMIN, linux only
+ */
+class ProcEventStream : private Stupid::Base::Uncopy
+{
+public:
+    ProcEventStream();
+    ~ProcEventStream();
+
+public:
+    bool init();
+    void exit();
+    bool is_open() const;
+    int fd() const;
+
+public:
+    /*
+     * read all pending events without blocking,
+     * return false if events were lost (receive buffer overrun),
+     * then the caller must rebuild its process table from /proc
+     */
+    bool read(std::vector<ProcEvent> & event_list);
+
+private:
+    int                                     m_socket;
+    bool                                    m_listening;    /* PROC_CN_MCAST_LISTEN is sent */
+    std::vector<char>                       m_buffer;
+};
+
+
+#endif // DAEMON_PROC_CONNECTOR_H
@@ -0,0 +1,138 @@
+/********************************************************
+ * Description : process launcher of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifndef DAEMON_PROCESS_LAUNCHER_H
+#define DAEMON_PROCESS_LAUNCHER_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <vector>
+
+/*
+ * one setrlimit() of the spawned child, soft and hard limit are both value
+ */
+struct SpawnLimit
+{
+    int                     resource;           /* RLIMIT_*                              */
+    uint64_t                value;
+};
+
+/*
+ * cpu, memory and scheduling placement of the spawned child, fixed size,
+ * so it is copied with the launch spec and the spawn path does no allocation,
+ * every part is applied before execv or the spawn fails, the service never
+ * runs with half of it
+ */
+struct SpawnScheduling
+{
+    enum { mask_words = 16 };                   /* 1024 cpus or numa nodes               */
+
+    bool                    set_cpus;
+    uint64_t                cpu_mask[mask_words];   /* bit n % 64 of word n / 64 is cpu n */
+    int                     numa_mode;          /* MPOL_*, -1: inherit                   */
+    uint64_t                node_mask[mask_words];
+    bool                    set_nice;
+    int                     nice;               /* -20 ~ 19                              */
+    int                     ioprio;             /* (class << 13) | level, -1: inherit    */
+    int                     policy;             /* SCHED_*, -1: inherit                  */
+    int                     priority;           /* 1 ~ 99 for SCHED_FIFO and SCHED_RR    */
+};
+
+/*
+ * everything a launch needs, compiled once when the config is loaded:
+ * the absolute executable, the tokenized argv, the working directory and
+ * the environment block all live in one allocation (argv and envp point
+ * into it), so the spawn path does no parsing and no allocation
+ */
+class LaunchSpec
+{
+public:
+    LaunchSpec();
+    LaunchSpec(const LaunchSpec & other);
+    LaunchSpec & operator = (const LaunchSpec & other);
+    ~LaunchSpec();
+
+public:
+    /*
+     * every param is split on blanks outside double quotes, and the quotes
+     * are removed: <param>"argv 2"</param> is one argument: argv 2
+     * every env is "NAME=value", it replaces or extends the daemon's environment
+     */
+    bool build(const std::string & path, const std::string & file, const std::list<std::string> & params, const std::list<std::string> & envs);
+    void set_limits(const std::vector<SpawnLimit> & limits);
+    void set_scheduling(const SpawnScheduling & scheduling);
+    void clear();
+
+public:
+    bool empty() const;
+    const char * file() const;
+    const char * work_directory() const;
+    char * const * argv() const;
+    char * const * envp() const;
+    const std::string & command_line() const; /* argv joined by blank, as /proc shows it */
+    const std::vector<SpawnLimit> & limits() const;
+    const SpawnScheduling * scheduling() const; /* nullptr: inherit from the daemon */
+
+private:
+    void copy_from(const LaunchSpec & other);
+
+private:
+    char *                  m_block;
+    size_t                  m_block_size;
+    char **                 m_argv;
+    char **                 m_envp;
+    const char *            m_file;
+    const char *            m_work_directory;
+    std::string             m_command_line;
+    std::vector<SpawnLimit> m_limits;
+    bool                    m_has_scheduling;
+    SpawnScheduling         m_scheduling;
+};
+
+struct SpawnAttributes
+{
+    const char *            file;               /* executable to run                     */
+    char * const *          argv;               /* nullptr terminated                    */
+    char * const *          envp;               /* nullptr: inherit the environment      */
+    const char *            work_directory;     /* nullptr: keep the current directory   */
+    bool                    close_stdio;        /* close stdin, stdout and stderr        */
+    bool                    new_process_group;  /* setpgid(0, 0), the pgid is the pid    */
+    int                     cgroup_procs_fd;    /* cgroup.procs to join, -1: no cgroup   */
+    const SpawnLimit *      limits;             /* setrlimit() before execv              */
+    size_t                  limit_count;
+    bool                    limits_in_cgroup;   /* the cgroup enforces them, so limits   */
+                                                /* are set only if joining it fails      */
+    const SpawnScheduling * scheduling;         /* nullptr: inherit from the daemon      */
+};
+
+struct SpawnResult
+{
+    size_t                  pid;
+    int                     error;              /* errno of the failed step, 0 if ok     */
+    const char *            error_step;         /* name of the failed step               */
+    int                     chdir_error;        /* not fatal, the service still runs     */
+    int                     cgroup_error;       /* not fatal, runs in the daemon cgroup  */
+};
+
+/*
+ * linux only, start a process with clone(CLONE_VM | CLONE_VFORK):
+ * the child borrows the address space of the daemon until execv, so no page
+ * table is copied and the cost does not grow with the daemon's RSS,
+ * the child only makes raw system calls (no allocation, no lock, no log),
+ * and execv failure is reported back through the shared memory
+ */
+extern bool spawn_process(const SpawnAttributes & attributes, SpawnResult & result);
+
+
+#endif // DAEMON_PROCESS_LAUNCHER_H
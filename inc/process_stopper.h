@@ -0,0 +1,70 @@
+/********************************************************
+ * Description : process stopper of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifndef DAEMON_PROCESS_STOPPER_H
+#define DAEMON_PROCESS_STOPPER_H
+
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "base/utility/uncopy.h"
+#include "process_table.h"
+#include "cgroup.h"
+
+/*
+ * stop the process tree of a service without blocking the caller:
+ * stop() sends SIGTERM and arms a grace deadline, check() sends SIGKILL
+ * to every tree whose deadline is passed, and reports the stop as done
+ * once the main process is gone and the tree is empty
+ * (cgroup.events "populated 0", or no process left in the process group),
+ * so any number of services can be stopping at the same time
+ *
+ * the tree is the cgroup of the service if it has one, else its process group
+ * (the pgid is the pid of the main process, see create_process)
+ *
+ * on windows, there is no graceful stop, stop() terminates the main process at once
+ */
+class ProcessStopper : private Stupid::Base::Uncopy
+{
+public:
+    explicit ProcessStopper(CgroupManager & cgroup_manager);
+
+public:
+    bool stop(const PROCESS_IDENTITY & process_identity, const std::string & cgroup_name, uint64_t grace_ms);
+    void check(uint64_t now_ms, std::vector<size_t> & stopped_list);
+    uint64_t next_check_time() const;   /* UINT64_MAX if nothing is stopping */
+    bool is_stopping(size_t process_id) const;
+    size_t size() const;
+
+private:
+    struct StopInfo
+    {
+        PROCESS_IDENTITY    identity;
+        std::string         cgroup;     /* empty: the process group */
+        uint64_t            deadline;
+        bool                killed;
+        uint64_t            kill_time;  /* of the first SIGKILL, 0 if not killed */
+    };
+
+private:
+    bool is_running(const StopInfo & stop_info) const;
+    bool send_signal(const StopInfo & stop_info, bool force);
+
+private:
+    CgroupManager                 & m_cgroup_manager;
+    std::map<size_t, StopInfo>      m_stop_map;
+    uint64_t                        m_last_check_time;
+};
+
+
+#endif // DAEMON_PROCESS_STOPPER_H
@@ -0,0 +1,140 @@
+/********************************************************
+ * Description : process table of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifndef DAEMON_PROCESS_TABLE_H
+#define DAEMON_PROCESS_TABLE_H
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+#include "proc_connector.h"
+
+struct PROCESS_INFO
+{
+    size_t        pid;  /* process id                              */
+    std::string   cmd;  /* command line, arguments joined by space */
+    std::string   args; /* command line, arguments separated by \0 */
+};
+
+/*
+ * a process is the same process only if both pid and start time are the same,
+ * so a reused pid is never taken as the process which had it before
+ */
+struct PROCESS_IDENTITY
+{
+    size_t        pid;          /* process id                                          */
+    uint64_t      start_time;   /* linux: field 22 of /proc/<pid>/stat, in clock ticks */
+                                /* windows: creation time of the process, as FILETIME */
+};
+
+/*
+ * on linux, walk /proc with getdents64 and read /proc/<pid>/cmdline directly,
+ * no helper process (like "ps") is spawned
+ */
+extern bool get_all_process(std::vector<PROCESS_INFO> & process_list);
+
+/*
+ * read one process only, used for a process which is not in the snapshot yet
+ */
+extern bool get_process_info(size_t process_id, PROCESS_INFO & process_info);
+
+/*
+ * read the identity of a running process, false if it is not exist or a zombie,
+ * on linux only /proc/<pid>/stat is read
+ */
+extern bool get_process_identity(size_t process_id, PROCESS_IDENTITY & process_identity);
+
+/*
+ * the process table taken once per check,
+ * shared by all liveness, kill and naming calls of the same check
+ *
+ * entries are kept in one flat array, command lines in one string pool,
+ * and two open-addressing indexes (by pid, by command line hash) make
+ * every lookup O(1) instead of a walk over the whole table
+ *
+ * with the process event stream open, the table is scanned from /proc once,
+ * then kept up to date by fork/exec/exit events, refresh() does no rescan
+ * unless events were lost
+ *
+ * without it, a rescan keeps the entries of the last scan keyed by
+ * (pid, start time), only a new pid, or a pid whose /proc directory is
+ * rebuilt, is read again, gone pids are dropped by a sorted merge,
+ * so a process which calls exec later keeps the command line of the scan
+ * which found it
+ *
+ * pids born and died since the last take_changes() are kept for the caller
+ */
+class ProcessSnapshot
+{
+public:
+    ProcessSnapshot();
+
+public:
+    bool open_event_stream();
+    void close_event_stream();
+    void update();
+    int event_fd() const;   /* the event stream, -1 if it is not open */
+    bool refresh();
+    uint64_t generation() const;
+    size_t size() const;
+    void take_changes(std::vector<size_t> & born_list, std::vector<size_t> & died_list);
+
+public:
+    bool find(size_t process_id, std::string & process_name) const;
+    bool is_alive(size_t process_id, const std::string & process_name) const;
+    bool is_alive(const std::string & process_name) const;
+
+private:
+    struct Entry
+    {
+        size_t        pid;
+        uint64_t      start_time;   /* 0 if unknown                         */
+        uint64_t      inode;        /* of /proc/<pid> at the last scan      */
+        uint64_t      cmd_hash;
+        size_t        args_offset;
+        size_t        args_size;    /* 0 for kernel threads, never matched  */
+    };
+
+    /* pid and inode of /proc/<pid> */
+    typedef std::vector<std::pair<size_t, uint64_t> > dirent_list_t;
+
+private:
+    static void append_entry(void * context, size_t pid, const char * args, size_t size);
+    static bool entry_pid_less(const Entry & lhs, const Entry & rhs);
+    bool rescan();
+    void apply_events();
+    void compact_args_pool();
+    void build_index();
+    Entry * find_entry(size_t process_id);
+    const Entry * find_entry(size_t process_id) const;
+    bool match_entry(const Entry & entry, uint64_t cmd_hash, const std::string & process_name) const;
+
+private:
+    uint64_t                        m_generation;
+    std::vector<Entry>              m_entries;
+    std::vector<Entry>              m_merge_entries;
+    dirent_list_t                   m_dirent_list;
+    std::string                     m_args_pool;
+    std::string                     m_args_buffer;
+    size_t                          m_index_mask;
+    std::vector<uint32_t>           m_pid_index;
+    std::vector<uint32_t>           m_cmd_index;
+    ProcEventStream                 m_event_stream;
+    bool                            m_synchronized;
+    std::vector<ProcEvent>          m_event_list;
+    std::vector<size_t>             m_born_list;
+    std::vector<size_t>             m_died_list;
+};
+
+
+#endif // DAEMON_PROCESS_TABLE_H
@@ -0,0 +1,72 @@
+/********************************************************
+ * Description : process exit watcher of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifndef DAEMON_PROCESS_WATCHER_H
+#define DAEMON_PROCESS_WATCHER_H
+
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "base/utility/uncopy.h"
+
+struct ProcessExit
+{
+    size_t        pid;          /* process id                                  */
+    bool          reaped;       /* false if it is not a child of this process  */
+    int           exit_code;    /* valid if exited normally                    */
+    int           signal;       /* not 0 if terminated by a signal             */
+    uint64_t      cpu_time_ms;  /* user + system, valid if reaped              */
+    uint64_t      max_rss;      /* peak resident bytes, valid if reaped (linux) */
+};
+
+/*
+ * on linux, every watched process is a pidfd in one epoll set,
+ * and a signalfd of SIGCHLD is in the same set, every exited child is
+ * reaped at once (no zombie left) and reported as soon as it happens
+ *
+ * SIGCHLD must be blocked in all threads (see main), or the signalfd misses it
+ */
+class ProcessWatcher : private Stupid::Base::Uncopy
+{
+public:
+    ProcessWatcher();
+    ~ProcessWatcher();
+
+public:
+    bool init();
+    void exit();
+
+public:
+    bool watch(size_t process_id);
+    void unwatch(size_t process_id);
+    bool wait(int timeout_ms, std::vector<ProcessExit> & exit_list);
+    int event_fd() const;   /* readable when wait() has something, -1 if none */
+
+private:
+    void reap_children(std::vector<ProcessExit> & exit_list);
+
+private:
+#ifdef _MSC_VER
+    typedef void *                  process_handle_t;
+#else
+    typedef int                     process_handle_t;
+#endif // _MSC_VER
+
+private:
+    bool                                    m_supported;
+    int                                     m_epoll_fd;
+    int                                     m_signal_fd;
+    std::map<size_t, process_handle_t>      m_process_map;
+};
+
+
+#endif // DAEMON_PROCESS_WATCHER_H
@@ -0,0 +1,100 @@
+/********************************************************
+ * Description : resource sampler of daemon services
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifndef DAEMON_RESOURCE_SAMPLER_H
+#define DAEMON_RESOURCE_SAMPLER_H
+
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "base/utility/uncopy.h"
+#include "process_watcher.h"
+
+struct ResourceSample
+{
+    uint64_t      time_ms;      /* monotonic time of the sample                          */
+    uint64_t      cpu_time_ms;  /* user + system of the process (or its cgroup) so far   */
+    uint32_t      cpu_usage;    /* per mille of one cpu since the previous sample        */
+    uint32_t      threads;      /* 0 if unknown                                          */
+    uint32_t      fds;          /* open files (handles on windows), 0 if unknown         */
+    uint64_t      rss;          /* resident bytes (of the cgroup if it has memory.current),
+                                   the peak of the process if exited                     */
+    bool          exited;       /* the last sample of a process, from wait4 rusage       */
+};
+
+/*
+ * every tracked service has a fixed size ring of samples,
+ * which is kept over restarts of the service
+ *
+ * on linux, the /proc/<pid> files (stat, statm, fd) and the cgroup files
+ * (cpu.stat, memory.current) are opened once when the process is tracked,
+ * then every sample is one pread per file into the same buffer,
+ * so sampling does no open, no close and no allocation
+ *
+ * when the process exits, its wait4 rusage is folded in as the last sample
+ */
+class ResourceSampler : private Stupid::Base::Uncopy
+{
+public:
+    ResourceSampler();
+    ~ResourceSampler();
+
+public:
+    void init(uint64_t interval_ms, size_t history_size);
+    void exit();
+
+public:
+    void track(const std::string & service, size_t process_id, const std::string & cgroup_path);
+    void untrack(const std::string & service, const ProcessExit & process_exit);
+    void sample(uint64_t now_ms);
+    uint64_t next_sample_time() const;  /* UINT64_MAX if nothing is tracked */
+
+public:
+    bool get_latest(const std::string & service, ResourceSample & resource_sample) const;
+    void get_history(const std::string & service, std::vector<ResourceSample> & sample_list) const;
+
+private:
+    struct Track
+    {
+        size_t                          pid;        /* 0: not running                */
+        int                             stat_fd;
+        int                             statm_fd;
+        int                             fd_dir_fd;
+        int                             cpu_stat_fd;    /* -1: not in a cgroup       */
+        int                             memory_fd;      /* -1: no memory controller  */
+        void *                          process;        /* windows only              */
+        uint64_t                        last_cpu_time_ms;
+        uint64_t                        last_time_ms;
+        std::vector<ResourceSample>     ring;
+        size_t                          ring_head;      /* next slot to write        */
+        size_t                          ring_count;
+    };
+
+private:
+    bool sample_track(Track & track, uint64_t now_ms, ResourceSample & resource_sample);
+    bool read_file(int fd);
+    void close_track(Track & track);
+    static void push_sample(Track & track, const ResourceSample & resource_sample);
+
+private:
+    uint64_t                            m_interval_ms;
+    size_t                              m_history_size;
+    uint64_t                            m_next_sample_ms;
+    uint64_t                            m_clock_ticks;
+    uint64_t                            m_page_size;
+    char                                m_buffer[4096];
+    std::map<std::string, Track>        m_track_map;
+};
+
+
+#endif // DAEMON_RESOURCE_SAMPLER_H
@@ -13,15 +13,19 @@
 #define DAEMON_UTILITY_H
 
 
-#include <list>
+#include <cstdint>
 #include <string>
+#include "process_table.h"
+#include "process_launcher.h"
 
 extern bool exclusive_init(const char * exclusive_unique_name, size_t & unique_id);
 extern void exclusive_exit(size_t & unique_id);
 
-extern bool create_process(const std::string & path, const std::string & command_line, bool show_window, size_t & process_id, std::string & process_name);
-extern bool kill_process(size_t process_id, const std::string & process_name);
-extern bool is_process_alive(const std::string & process_name);
+extern bool create_process(const LaunchSpec & launch_spec, const std::string & command_line, bool show_window, int cgroup_procs_fd, bool limits_in_cgroup, PROCESS_IDENTITY & process_identity, bool & in_cgroup);
+extern bool is_process_alive(const ProcessSnapshot & process_snapshot, const std::string & process_name);
+extern bool is_process_alive(const PROCESS_IDENTITY & process_identity);
+extern uint64_t get_monotonic_milliseconds();
+extern uint64_t get_monotonic_nanoseconds();
 
 
 #endif // DAEMON_UTILITY_H
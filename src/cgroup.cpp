@@ -0,0 +1,571 @@
+/********************************************************
+ * Description : cgroup v2 of daemon services
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#include "net/common/common.h"
+
+#ifndef _MSC_VER
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <signal.h>
+    #include <sys/stat.h>
+    #include <sys/types.h>
+    #include <sys/epoll.h>
+#endif // _MSC_VER
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "base/log/log.h"
+#include "cgroup.h"
+
+#ifndef _MSC_VER
+
+/*
+ * "<id> <parent> <major:minor> <root> <mount point> <options> ... - <fstype> <source> <options>"
+ */
+static bool find_cgroup2_mount(std::string & mount_root, std::string & mount_point)
+{
+    std::ifstream ifs("/proc/self/mountinfo");
+    if (!ifs.is_open())
+    {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        std::string::size_type separator = line.find(" - ");
+        if (std::string::npos == separator || 0 != line.compare(separator + 3, 8, "cgroup2 "))
+        {
+            continue;
+        }
+
+        std::istringstream iss(line.substr(0, separator));
+        std::string mount_id;
+        std::string parent_id;
+        std::string device;
+        if (iss >> mount_id >> parent_id >> device >> mount_root >> mount_point)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * the line of the unified hierarchy in /proc/self/cgroup is "0::<path>"
+ */
+static bool find_own_cgroup(std::string & cgroup_path)
+{
+    std::ifstream ifs("/proc/self/cgroup");
+    if (!ifs.is_open())
+    {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        if (0 == line.compare(0, 3, "0::"))
+        {
+            cgroup_path = line.substr(3);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool make_directory(const std::string & path)
+{
+    if (0 == ::mkdir(path.c_str(), 0755) || EEXIST == errno)
+    {
+        return true;
+    }
+    RUN_LOG_DBG("mkdir(%s) failed: %d", path.c_str(), stupid_system_error());
+    return false;
+}
+
+/*
+ * errno is kept for the caller
+ */
+static bool write_file(const std::string & file, const std::string & value)
+{
+    int fd = ::open(file.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    bool ret = (static_cast<ssize_t>(value.size()) == ::write(fd, value.c_str(), value.size()));
+    int error = errno;
+    ::close(fd);
+    errno = error;
+
+    return ret;
+}
+
+static bool has_controller(const std::string & path, const std::string & controller)
+{
+    std::ifstream ifs((path + "/cgroup.controllers").c_str());
+    if (!ifs.is_open())
+    {
+        return false;
+    }
+
+    std::string name;
+    while (ifs >> name)
+    {
+        if (controller == name)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#endif // _MSC_VER
+
+CgroupManager::CgroupManager()
+    : m_available(false)
+    , m_parent_path()
+    , m_root_path()
+    , m_controllers()
+    , m_epoll_fd(-1)
+    , m_cgroup_map()
+{
+
+}
+
+CgroupManager::~CgroupManager()
+{
+    exit();
+}
+
+bool CgroupManager::init()
+{
+    exit();
+
+#ifndef _MSC_VER
+    std::string mount_root;
+    std::string mount_point;
+    std::string cgroup_path;
+    if (!find_cgroup2_mount(mount_root, mount_point) || !find_own_cgroup(cgroup_path))
+    {
+        RUN_LOG_DBG("cgroup v2 is not mounted, services are stopped by process group");
+        return true;
+    }
+
+    /* in a cgroup namespace or a bind mount, the mount shows a sub tree only */
+    if ("/" != mount_root && 0 == cgroup_path.compare(0, mount_root.size(), mount_root))
+    {
+        cgroup_path.erase(0, mount_root.size());
+    }
+    if (!cgroup_path.empty() && '/' == *cgroup_path.rbegin())
+    {
+        cgroup_path.erase(cgroup_path.size() - 1);
+    }
+
+    /* moved there by enable_controller() before, by this daemon or the one it replaces */
+    const std::string main_name("/daemon.main");
+    if (cgroup_path.size() >= main_name.size() && 0 == cgroup_path.compare(cgroup_path.size() - main_name.size(), main_name.size(), main_name))
+    {
+        cgroup_path.erase(cgroup_path.size() - main_name.size());
+    }
+
+    m_parent_path = mount_point + cgroup_path;
+    m_root_path = m_parent_path + "/daemon.services";
+    if (!make_directory(m_root_path))
+    {
+        RUN_LOG_DBG("cgroup %s is not writable, services are stopped by process group", m_root_path.c_str());
+        m_parent_path.clear();
+        m_root_path.clear();
+        return true;
+    }
+
+    m_epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll_fd < 0)
+    {
+        RUN_LOG_ERR("epoll_create1 failed: %d", stupid_system_error());
+        m_parent_path.clear();
+        m_root_path.clear();
+        return false;
+    }
+
+    m_available = true;
+
+    RUN_LOG_DBG("services run in cgroup %s", m_root_path.c_str());
+#endif // _MSC_VER
+
+    return true;
+}
+
+void CgroupManager::exit()
+{
+#ifndef _MSC_VER
+    for (std::map<std::string, CgroupInfo>::iterator iter = m_cgroup_map.begin(); m_cgroup_map.end() != iter; ++iter)
+    {
+        ::close(iter->second.procs_fd);
+        ::close(iter->second.events_fd);
+    }
+
+    if (m_epoll_fd >= 0)
+    {
+        ::close(m_epoll_fd);
+        m_epoll_fd = -1;
+    }
+#endif // _MSC_VER
+
+    m_cgroup_map.clear();
+    m_controllers.clear();
+    m_parent_path.clear();
+    m_root_path.clear();
+    m_available = false;
+}
+
+bool CgroupManager::is_available() const
+{
+    return m_available;
+}
+
+bool CgroupManager::create(const std::string & cgroup_name)
+{
+    if (!m_available)
+    {
+        return false;
+    }
+
+    if (m_cgroup_map.end() != m_cgroup_map.find(cgroup_name))
+    {
+        return true;
+    }
+
+#ifdef _MSC_VER
+    return false;
+#else
+    CgroupInfo cgroup_info;
+    cgroup_info.path = m_root_path + "/" + cgroup_name;
+    cgroup_info.procs_fd = -1;
+    cgroup_info.events_fd = -1;
+    cgroup_info.populated = false;
+
+    if (!make_directory(cgroup_info.path))
+    {
+        RUN_LOG_ERR("create cgroup %s failed", cgroup_info.path.c_str());
+        return false;
+    }
+
+    do
+    {
+        cgroup_info.procs_fd = ::open((cgroup_info.path + "/cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+        if (cgroup_info.procs_fd < 0)
+        {
+            RUN_LOG_ERR("open(%s/cgroup.procs) failed: %d", cgroup_info.path.c_str(), stupid_system_error());
+            break;
+        }
+
+        cgroup_info.events_fd = ::open((cgroup_info.path + "/cgroup.events").c_str(), O_RDONLY | O_CLOEXEC);
+        if (cgroup_info.events_fd < 0)
+        {
+            RUN_LOG_ERR("open(%s/cgroup.events) failed: %d", cgroup_info.path.c_str(), stupid_system_error());
+            break;
+        }
+
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLPRI;
+        event.data.fd = cgroup_info.events_fd;
+        if (::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, cgroup_info.events_fd, &event) < 0)
+        {
+            RUN_LOG_ERR("epoll_ctl(add %s/cgroup.events) failed: %d", cgroup_info.path.c_str(), stupid_system_error());
+            break;
+        }
+
+        read_populated(cgroup_info.events_fd, cgroup_info.populated);
+
+        m_cgroup_map[cgroup_name] = cgroup_info;
+
+        return true;
+    } while (false);
+
+    if (cgroup_info.procs_fd >= 0)
+    {
+        ::close(cgroup_info.procs_fd);
+    }
+    if (cgroup_info.events_fd >= 0)
+    {
+        ::close(cgroup_info.events_fd);
+    }
+
+    return false;
+#endif // _MSC_VER
+}
+
+bool CgroupManager::set_limits(const std::string & cgroup_name, const cgroup_limits_t & limits)
+{
+#ifdef _MSC_VER
+    return limits.empty();
+#else
+    std::map<std::string, CgroupInfo>::const_iterator iter = m_cgroup_map.find(cgroup_name);
+    if (m_cgroup_map.end() == iter)
+    {
+        return limits.empty();
+    }
+
+    static const char * const limit_defaults[][2] =
+    {
+        { "memory.max",     "max"         },
+        { "memory.high",    "max"         },
+        { "cpu.max",        "max"         },
+        { "cpu.weight",     "100"         },
+        { "io.weight",      "default 100" },
+        { "pids.max",       "max"         }
+    };
+
+    bool ret = true;
+
+    for (size_t index = 0; index < sizeof(limit_defaults) / sizeof(limit_defaults[0]); ++index)
+    {
+        const std::string file(limit_defaults[index][0]);
+        cgroup_limits_t::const_iterator iter_limit = limits.find(file);
+        if (limits.end() == iter_limit)
+        {
+            /* the file is not there if the controller is not enabled, nothing to reset then */
+            write_file(iter->second.path + "/" + file, limit_defaults[index][1]);
+            continue;
+        }
+
+        if (!enable_controller(file.substr(0, file.find('.'))))
+        {
+            ret = false;
+            continue;
+        }
+
+        if (!write_file(iter->second.path + "/" + file, iter_limit->second))
+        {
+            RUN_LOG_ERR("write(%s/%s, %s) failed: %d", iter->second.path.c_str(), file.c_str(), iter_limit->second.c_str(), stupid_system_error());
+            ret = false;
+        }
+    }
+
+    return ret;
+#endif // _MSC_VER
+}
+
+int CgroupManager::procs_fd(const std::string & cgroup_name) const
+{
+    std::map<std::string, CgroupInfo>::const_iterator iter = m_cgroup_map.find(cgroup_name);
+    if (m_cgroup_map.end() == iter)
+    {
+        return -1;
+    }
+    return iter->second.procs_fd;
+}
+
+std::string CgroupManager::path(const std::string & cgroup_name) const
+{
+    std::map<std::string, CgroupInfo>::const_iterator iter = m_cgroup_map.find(cgroup_name);
+    if (m_cgroup_map.end() == iter)
+    {
+        return std::string();
+    }
+    return iter->second.path;
+}
+
+bool CgroupManager::is_populated(const std::string & cgroup_name) const
+{
+    std::map<std::string, CgroupInfo>::const_iterator iter = m_cgroup_map.find(cgroup_name);
+    if (m_cgroup_map.end() == iter)
+    {
+        return false;
+    }
+    return iter->second.populated;
+}
+
+bool CgroupManager::signal(const std::string & cgroup_name, int signo)
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    std::map<std::string, CgroupInfo>::const_iterator iter = m_cgroup_map.find(cgroup_name);
+    if (m_cgroup_map.end() == iter)
+    {
+        return false;
+    }
+
+    std::ifstream ifs((iter->second.path + "/cgroup.procs").c_str());
+    if (!ifs.is_open())
+    {
+        RUN_LOG_ERR("open(%s/cgroup.procs) failed: %d", iter->second.path.c_str(), stupid_system_error());
+        return false;
+    }
+
+    pid_t pid = 0;
+    while (ifs >> pid)
+    {
+        ::kill(pid, signo);
+    }
+
+    return true;
+#endif // _MSC_VER
+}
+
+bool CgroupManager::kill(const std::string & cgroup_name)
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    std::map<std::string, CgroupInfo>::const_iterator iter = m_cgroup_map.find(cgroup_name);
+    if (m_cgroup_map.end() == iter)
+    {
+        return false;
+    }
+
+    /* cgroup.kill (linux 5.14) kills the whole tree, forks in flight included */
+    int fd = ::open((iter->second.path + "/cgroup.kill").c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return signal(cgroup_name, SIGKILL);
+    }
+
+    bool ret = (1 == ::write(fd, "1", 1));
+    if (!ret)
+    {
+        RUN_LOG_ERR("write(%s/cgroup.kill) failed: %d", iter->second.path.c_str(), stupid_system_error());
+    }
+    ::close(fd);
+
+    return ret || signal(cgroup_name, SIGKILL);
+#endif // _MSC_VER
+}
+
+void CgroupManager::update()
+{
+#ifndef _MSC_VER
+    if (m_epoll_fd < 0 || m_cgroup_map.empty())
+    {
+        return;
+    }
+
+    struct epoll_event events[32];
+    int count = ::epoll_wait(m_epoll_fd, events, sizeof(events) / sizeof(events[0]), 0);
+    for (int index = 0; index < count; ++index)
+    {
+        for (std::map<std::string, CgroupInfo>::iterator iter = m_cgroup_map.begin(); m_cgroup_map.end() != iter; ++iter)
+        {
+            if (iter->second.events_fd == events[index].data.fd)
+            {
+                read_populated(iter->second.events_fd, iter->second.populated);
+                break;
+            }
+        }
+    }
+#endif // _MSC_VER
+}
+
+int CgroupManager::event_fd() const
+{
+    return m_epoll_fd;
+}
+
+bool CgroupManager::enable_controller(const std::string & controller)
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    if (m_controllers.end() != m_controllers.find(controller))
+    {
+        return true;
+    }
+
+    /* a controller is offered to daemon.services only if the cgroup of the daemon enables it */
+    if (!has_controller(m_root_path, controller))
+    {
+        if (!has_controller(m_parent_path, controller))
+        {
+            RUN_LOG_ERR("cgroup controller %s is not delegated to %s", controller.c_str(), m_parent_path.c_str());
+            return false;
+        }
+
+        if (!write_file(m_parent_path + "/cgroup.subtree_control", "+" + controller))
+        {
+            /*
+             * EBUSY: a cgroup with processes can not enable controllers for its children
+             * (no internal process rule), so the daemon moves to a leaf of its own first
+             */
+            if (EBUSY != errno)
+            {
+                RUN_LOG_ERR("enable cgroup controller %s in %s failed: %d", controller.c_str(), m_parent_path.c_str(), stupid_system_error());
+                return false;
+            }
+
+            const std::string main_path(m_parent_path + "/daemon.main");
+            if (!make_directory(main_path) || !write_file(main_path + "/cgroup.procs", "0"))
+            {
+                RUN_LOG_ERR("move daemon to cgroup %s failed: %d", main_path.c_str(), stupid_system_error());
+                return false;
+            }
+
+            if (!write_file(m_parent_path + "/cgroup.subtree_control", "+" + controller))
+            {
+                RUN_LOG_ERR("enable cgroup controller %s in %s failed: %d", controller.c_str(), m_parent_path.c_str(), stupid_system_error());
+                return false;
+            }
+
+            RUN_LOG_DBG("daemon is moved to cgroup %s", main_path.c_str());
+        }
+    }
+
+    if (!write_file(m_root_path + "/cgroup.subtree_control", "+" + controller))
+    {
+        RUN_LOG_ERR("enable cgroup controller %s in %s failed: %d", controller.c_str(), m_root_path.c_str(), stupid_system_error());
+        return false;
+    }
+
+    m_controllers.insert(controller);
+
+    RUN_LOG_DBG("cgroup controller %s is enabled in %s", controller.c_str(), m_root_path.c_str());
+
+    return true;
+#endif // _MSC_VER
+}
+
+bool CgroupManager::read_populated(int events_fd, bool & populated)
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    /* the file changes in place, so it is always read from the beginning */
+    char buff[256] = { 0 };
+    ssize_t size = ::pread(events_fd, buff, sizeof(buff) - 1, 0);
+    if (size <= 0)
+    {
+        return false;
+    }
+    buff[size] = '\0';
+
+    const char * field = strstr(buff, "populated ");
+    if (nullptr == field)
+    {
+        return false;
+    }
+
+    populated = ('0' != field[10]);
+
+    return true;
+#endif // _MSC_VER
+}
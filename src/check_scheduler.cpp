@@ -0,0 +1,149 @@
+/********************************************************
+ * Description : check scheduler of daemon services
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifdef _MSC_VER
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif // _MSC_VER
+
+#include <algorithm>
+
+#include "check_scheduler.h"
+#include "utility.h"
+
+CheckScheduler::CheckScheduler()
+    : m_task_heap()
+    , m_sequence_map()
+    , m_sequence(0)
+    , m_random(0)
+{
+#ifdef _MSC_VER
+    m_random = get_monotonic_nanoseconds() ^ (static_cast<uint64_t>(::GetCurrentProcessId()) << 32);
+#else
+    m_random = get_monotonic_nanoseconds() ^ (static_cast<uint64_t>(::getpid()) << 32);
+#endif // _MSC_VER
+    if (0 == m_random)
+    {
+        m_random = 88172645463325252ULL;
+    }
+}
+
+void CheckScheduler::clear()
+{
+    m_task_heap.clear();
+    m_sequence_map.clear();
+}
+
+void CheckScheduler::schedule(const std::string & key, uint64_t due_time)
+{
+    Task task;
+    task.due_time = due_time;
+    task.sequence = ++m_sequence;
+    task.key = key;
+
+    m_sequence_map[key] = task.sequence;
+    m_task_heap.push_back(task);
+    std::push_heap(m_task_heap.begin(), m_task_heap.end(), task_later);
+
+    if (m_task_heap.size() > 64 && m_task_heap.size() > 2 * m_sequence_map.size())
+    {
+        rebuild();
+    }
+}
+
+bool CheckScheduler::has(const std::string & key) const
+{
+    return m_sequence_map.end() != m_sequence_map.find(key);
+}
+
+uint64_t CheckScheduler::next_due_time()
+{
+    pop_stale();
+    return (m_task_heap.empty() ? UINT64_MAX : m_task_heap.front().due_time);
+}
+
+void CheckScheduler::take_due(uint64_t now, std::vector<DueTask> & due_list)
+{
+    due_list.clear();
+
+    while (true)
+    {
+        pop_stale();
+        if (m_task_heap.empty() || m_task_heap.front().due_time > now)
+        {
+            break;
+        }
+
+        std::pop_heap(m_task_heap.begin(), m_task_heap.end(), task_later);
+        m_sequence_map.erase(m_task_heap.back().key);
+        DueTask due_task;
+        due_task.key = m_task_heap.back().key;
+        due_task.due_time = m_task_heap.back().due_time;
+        due_list.push_back(due_task);
+        m_task_heap.pop_back();
+    }
+}
+
+size_t CheckScheduler::size() const
+{
+    return m_sequence_map.size();
+}
+
+uint64_t CheckScheduler::jitter(uint64_t range)
+{
+    if (0 == range)
+    {
+        return 0;
+    }
+
+    /* xorshift64 */
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 7;
+    m_random ^= m_random << 17;
+
+    return m_random % (range + 1);
+}
+
+bool CheckScheduler::task_later(const Task & lhs, const Task & rhs)
+{
+    return lhs.due_time > rhs.due_time || (lhs.due_time == rhs.due_time && lhs.sequence > rhs.sequence);
+}
+
+void CheckScheduler::pop_stale()
+{
+    while (!m_task_heap.empty())
+    {
+        std::map<std::string, uint64_t>::const_iterator iter = m_sequence_map.find(m_task_heap.front().key);
+        if (m_sequence_map.end() != iter && iter->second == m_task_heap.front().sequence)
+        {
+            break;
+        }
+        std::pop_heap(m_task_heap.begin(), m_task_heap.end(), task_later);
+        m_task_heap.pop_back();
+    }
+}
+
+void CheckScheduler::rebuild()
+{
+    std::vector<Task> task_heap;
+    task_heap.reserve(m_sequence_map.size());
+    for (std::vector<Task>::iterator iter = m_task_heap.begin(); m_task_heap.end() != iter; ++iter)
+    {
+        std::map<std::string, uint64_t>::const_iterator iter_sequence = m_sequence_map.find(iter->key);
+        if (m_sequence_map.end() != iter_sequence && iter_sequence->second == iter->sequence)
+        {
+            task_heap.push_back(*iter);
+        }
+    }
+    std::make_heap(task_heap.begin(), task_heap.end(), task_later);
+    m_task_heap.swap(task_heap);
+}
@@ -0,0 +1,140 @@
+/********************************************************
+ * Description : config watcher of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#include "net/common/common.h"
+
+#ifndef _MSC_VER
+    #include <errno.h>
+    #include <limits.h>
+    #include <unistd.h>
+    #include <sys/inotify.h>
+#endif // _MSC_VER
+
+#include <cstring>
+
+#include "base/log/log.h"
+#include "config_watcher.h"
+
+ConfigWatcher::ConfigWatcher()
+    : m_inotify_fd(-1)
+    , m_watch_fd(-1)
+    , m_file_name()
+    , m_buffer()
+{
+
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+    exit();
+}
+
+bool ConfigWatcher::init(const std::string & directory, const std::string & file_name)
+{
+    exit();
+
+#ifdef _MSC_VER
+    return false;
+#else
+    m_inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify_fd < 0)
+    {
+        RUN_LOG_ERR("inotify_init1 failed: %d", stupid_system_error());
+        return false;
+    }
+
+    m_watch_fd = ::inotify_add_watch(m_inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (m_watch_fd < 0)
+    {
+        RUN_LOG_ERR("inotify_add_watch(%s) failed: %d", directory.c_str(), stupid_system_error());
+        exit();
+        return false;
+    }
+
+    m_file_name = file_name;
+    m_buffer.resize(64 * (sizeof(struct inotify_event) + NAME_MAX + 1));
+
+    return true;
+#endif // _MSC_VER
+}
+
+void ConfigWatcher::exit()
+{
+#ifndef _MSC_VER
+    if (m_inotify_fd >= 0)
+    {
+        ::close(m_inotify_fd);
+        m_inotify_fd = -1;
+    }
+#endif // _MSC_VER
+    m_watch_fd = -1;
+}
+
+bool ConfigWatcher::is_open() const
+{
+    return (m_watch_fd >= 0);
+}
+
+int ConfigWatcher::event_fd() const
+{
+    return (m_inotify_fd);
+}
+
+bool ConfigWatcher::update()
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    if (!is_open())
+    {
+        return false;
+    }
+
+    bool written = false;
+
+    while (true)
+    {
+        ssize_t size = ::read(m_inotify_fd, &m_buffer[0], m_buffer.size());
+        if (size <= 0)
+        {
+            if (size < 0 && EINTR == errno)
+            {
+                continue;
+            }
+            break;
+        }
+
+        for (ssize_t offset = 0; offset + static_cast<ssize_t>(sizeof(struct inotify_event)) <= size;)
+        {
+            const struct inotify_event * event = reinterpret_cast<const struct inotify_event *>(&m_buffer[offset]);
+            offset += sizeof(struct inotify_event) + event->len;
+
+            if (0 != (event->mask & IN_Q_OVERFLOW))
+            {
+                RUN_LOG_ERR("inotify queue overflow, the config is taken as written");
+                written = true;
+            }
+            else if (0 != (event->mask & IN_IGNORED))
+            {
+                /* the directory is gone, nothing is watched any more */
+                RUN_LOG_ERR("config directory is not watched any more");
+                m_watch_fd = -1;
+            }
+            else if (event->len > 0 && m_file_name == event->name)
+            {
+                written = true;
+            }
+        }
+    }
+
+    return written;
+#endif // _MSC_VER
+}
@@ -0,0 +1,288 @@
+/********************************************************
+ * Description : cpu topology of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifndef _MSC_VER
+    #include <sched.h>
+#endif // _MSC_VER
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include "base/log/log.h"
+#include "cpu_topology.h"
+
+#ifdef _MSC_VER
+    #define CPU_SETSIZE 1024
+#endif // _MSC_VER
+
+static bool read_line(const std::string & file, std::string & line)
+{
+    std::ifstream ifs(file.c_str());
+    return ifs.is_open() && std::getline(ifs, line);
+}
+
+static std::string trim_blank(const std::string & text)
+{
+    const char * blanks = " \t\r\n";
+    std::string::size_type head = text.find_first_not_of(blanks);
+    if (std::string::npos == head)
+    {
+        return std::string();
+    }
+    return text.substr(head, text.find_last_not_of(blanks) - head + 1);
+}
+
+bool parse_cpu_list(const std::string & text, std::vector<size_t> & list)
+{
+    list.clear();
+
+    std::istringstream iss(text);
+    std::string item;
+    while (std::getline(iss, item, ','))
+    {
+        item = trim_blank(item);
+        if (item.empty())
+        {
+            continue;
+        }
+
+        char * end = nullptr;
+        size_t first = static_cast<size_t>(strtoul(item.c_str(), &end, 10));
+        if (end == item.c_str())
+        {
+            return false;
+        }
+
+        size_t last = first;
+        if ('-' == *end)
+        {
+            const char * range = end + 1;
+            last = static_cast<size_t>(strtoul(range, &end, 10));
+            if (end == range || last < first)
+            {
+                return false;
+            }
+        }
+
+        if ('\0' != *end)
+        {
+            return false;
+        }
+
+        /* a typo like "0-4000000000" must not fill the memory, no cpu set holds more than this */
+        if (last >= CPU_SETSIZE)
+        {
+            RUN_LOG_ERR("cpu %s is out of range, the max is %u", item.c_str(), static_cast<size_t>(CPU_SETSIZE - 1));
+            return false;
+        }
+
+        for (size_t index = first; index <= last; ++index)
+        {
+            list.push_back(index);
+        }
+    }
+
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+
+    return true;
+}
+
+bool get_process_cpus(size_t process_id, std::vector<size_t> & cpus)
+{
+    cpus.clear();
+
+#ifdef _MSC_VER
+    return false;
+#else
+    std::ostringstream oss;
+    oss << "/proc/" << process_id << "/status";
+
+    std::ifstream ifs(oss.str().c_str());
+    if (!ifs.is_open())
+    {
+        return false;
+    }
+
+    const char * field = "Cpus_allowed_list:";
+    const size_t field_size = strlen(field);
+
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        if (0 == line.compare(0, field_size, field))
+        {
+            return parse_cpu_list(line.substr(field_size), cpus);
+        }
+    }
+
+    return false;
+#endif // _MSC_VER
+}
+
+CpuTopology::CpuTopology()
+    : m_cpu_list()
+{
+
+}
+
+bool CpuTopology::load()
+{
+    m_cpu_list.clear();
+
+#ifdef _MSC_VER
+    return false;
+#else
+    std::string line;
+    std::vector<size_t> online_cpus;
+    if (!read_line("/sys/devices/system/cpu/online", line) || !parse_cpu_list(line, online_cpus))
+    {
+        RUN_LOG_ERR("read /sys/devices/system/cpu/online failed");
+        return false;
+    }
+
+    for (std::vector<size_t>::const_iterator iter = online_cpus.begin(); online_cpus.end() != iter; ++iter)
+    {
+        CpuInfo cpu_info;
+        cpu_info.cpu = *iter;
+        cpu_info.node = 0;
+        cpu_info.primary = true;
+
+        std::ostringstream oss;
+        oss << "/sys/devices/system/cpu/cpu" << *iter << "/topology/thread_siblings_list";
+
+        std::vector<size_t> siblings;
+        if (read_line(oss.str(), line) && parse_cpu_list(line, siblings) && !siblings.empty())
+        {
+            cpu_info.primary = (siblings[0] == *iter);
+        }
+
+        m_cpu_list.push_back(cpu_info);
+    }
+
+    /* no node directory on a kernel without numa, every cpu is in node 0 then */
+    std::vector<size_t> online_nodes;
+    if (read_line("/sys/devices/system/node/online", line) && parse_cpu_list(line, online_nodes))
+    {
+        for (std::vector<size_t>::const_iterator iter = online_nodes.begin(); online_nodes.end() != iter; ++iter)
+        {
+            std::ostringstream oss;
+            oss << "/sys/devices/system/node/node" << *iter << "/cpulist";
+
+            std::vector<size_t> node_cpus;
+            if (!read_line(oss.str(), line) || !parse_cpu_list(line, node_cpus))
+            {
+                continue;
+            }
+
+            for (std::vector<CpuInfo>::iterator iter_cpu = m_cpu_list.begin(); m_cpu_list.end() != iter_cpu; ++iter_cpu)
+            {
+                if (std::binary_search(node_cpus.begin(), node_cpus.end(), iter_cpu->cpu))
+                {
+                    iter_cpu->node = *iter;
+                }
+            }
+        }
+    }
+
+    return !m_cpu_list.empty();
+#endif // _MSC_VER
+}
+
+bool CpuTopology::empty() const
+{
+    return m_cpu_list.empty();
+}
+
+bool CpuTopology::resolve(const std::string & cpu_spec, std::vector<size_t> & cpus) const
+{
+    cpus.clear();
+
+    bool physical = false;
+
+    std::istringstream iss(cpu_spec);
+    std::string item;
+    while (std::getline(iss, item, ','))
+    {
+        item = trim_blank(item);
+        if (item.empty())
+        {
+            continue;
+        }
+
+        if ("physical" == item)
+        {
+            physical = true;
+            continue;
+        }
+
+        std::vector<size_t> list;
+        if (0 == item.compare(0, 5, "node "))
+        {
+            std::vector<size_t> nodes;
+            if (!parse_cpu_list(item.substr(5), nodes))
+            {
+                RUN_LOG_ERR("bad numa node in cpu spec {%s}", cpu_spec.c_str());
+                return false;
+            }
+            for (std::vector<CpuInfo>::const_iterator iter = m_cpu_list.begin(); m_cpu_list.end() != iter; ++iter)
+            {
+                if (std::binary_search(nodes.begin(), nodes.end(), iter->node))
+                {
+                    list.push_back(iter->cpu);
+                }
+            }
+        }
+        else if (!parse_cpu_list(item, list))
+        {
+            RUN_LOG_ERR("bad cpu list in cpu spec {%s}", cpu_spec.c_str());
+            return false;
+        }
+
+        cpus.insert(cpus.end(), list.begin(), list.end());
+    }
+
+    /* "physical" alone is every core */
+    if (cpus.empty() && physical)
+    {
+        for (std::vector<CpuInfo>::const_iterator iter = m_cpu_list.begin(); m_cpu_list.end() != iter; ++iter)
+        {
+            cpus.push_back(iter->cpu);
+        }
+    }
+
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+
+    if (physical)
+    {
+        std::vector<size_t> primary_cpus;
+        for (std::vector<CpuInfo>::const_iterator iter = m_cpu_list.begin(); m_cpu_list.end() != iter; ++iter)
+        {
+            if (iter->primary && std::binary_search(cpus.begin(), cpus.end(), iter->cpu))
+            {
+                primary_cpus.push_back(iter->cpu);
+            }
+        }
+        cpus.swap(primary_cpus);
+    }
+
+    if (cpus.empty())
+    {
+        RUN_LOG_ERR("cpu spec {%s} selects no cpu", cpu_spec.c_str());
+        return false;
+    }
+
+    return true;
+}
@@ -9,58 +9,448 @@
  * Copyright(C): 2015 - 2017
  ********************************************************/
 
+#include <set>
 #include <fstream>
-#include "net/utility/tcp.h"
+#include <sstream>
+#include <iomanip>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#ifndef _MSC_VER
+    #include <sched.h>
+    #include <unistd.h>
+    #include <sys/resource.h>
+    #include <linux/mempolicy.h>
+#endif // _MSC_VER
 #include "net/utility/utility.h"
 #include "daemon.h"
 #include "utility.h"
+#include "cpu_topology.h"
+#include "markup.h"
 #include "base/log/log.h"
 #include "base/time/time.h"
-#include "base/config/xml.h"
 #include "base/string/string.h"
 #include "base/filesystem/directory.h"
 
+/* the check intervals are clamped to [min, max] nanoseconds */
+static const uint64_t s_min_check_interval = 100ULL * 1000000;
+static const uint64_t s_max_check_interval = 300ULL * 1000000000;
+
+/*
+ * an exited service is started again after a delay, which doubles from the min
+ * to the max while the service keeps exiting in less than the stable uptime
+ * (nanoseconds), so a service which crashes at start does not restart in a loop
+ */
+static const uint64_t s_min_restart_delay = 100ULL * 1000000;
+static const uint64_t s_max_restart_delay = 30ULL * 1000000000;
+static const uint64_t s_stable_uptime = 60ULL * 1000000000;
+
+/* the task which reloads the config at the global interval without the config watcher, no service has an empty command line */
+static const std::string s_reload_task;
+
 struct ServiceInfo
 {
     bool                     show;
     std::string              host;
     std::list<std::string>   ports;
+    std::vector<const Endpoint *> endpoints; /* of the ports, in the same order */
     std::string              path;
     std::string              file;
     std::list<std::string>   params;
+    std::list<std::string>   envs;
+    uint64_t                 stop_timeout;
+    uint64_t                 check_interval; /* nanoseconds, 0 for the global one   */
+    uint64_t                 check_jitter;   /* nanoseconds, UINT64_MAX for a tenth of the interval */
+    uint64_t                 probe_timeout;
+    bool                     probe_persistent;
+    bool                     probe_listen;
+    bool                     probe_owner;
+    bool                     probe_http;
+    std::string              probe_port;     /* empty for every port */
+    std::string              probe_path;
+    int                      probe_status;
+    std::string              probe_body;
+    cgroup_limits_t          limits;
     std::string              cmdl;
+    std::string              cgroup;
+    LaunchSpec               launch_spec;
 };
 
-static bool parse_item(const std::string & service_conf, ServiceInfo & service_info)
+/*
+ * bytes with an optional K, M, G or T suffix, as memory.max takes it,
+ * false for "max" (no limit)
+ */
+static bool parse_memory_size(const std::string & text, uint64_t & size)
+{
+    char * end = nullptr;
+    size = static_cast<uint64_t>(strtoull(text.c_str(), &end, 10));
+    if (end == text.c_str())
+    {
+        return false;
+    }
+
+    static const char units[] = "KMGT";
+    const char * unit = strchr(units, toupper(static_cast<unsigned char>(*end)));
+    if ('\0' != *end && nullptr != unit)
+    {
+        size <<= 10 * (unit - units + 1);
+        ++end;
+    }
+
+    return '\0' == *end;
+}
+
+/*
+ * a time with an optional "ms" or "s" suffix and an optional fraction,
+ * in nanoseconds: "0.5", "500ms" and "0.5s" are the same, no suffix is seconds
+ */
+static bool parse_duration(const std::string & text, uint64_t & nanoseconds)
+{
+    char * end = nullptr;
+    const double value = strtod(text.c_str(), &end);
+    if (end == text.c_str() || !(value >= 0.0))
+    {
+        return false;
+    }
+
+    double unit = 1000000000.0;
+    if (0 == strcmp(end, "ms"))
+    {
+        unit = 1000000.0;
+        end += 2;
+    }
+    else if (0 == strcmp(end, "s"))
+    {
+        end += 1;
+    }
+
+    if ('\0' != *end || value * unit >= 18446744073709551615.0)
+    {
+        return false;
+    }
+
+    nanoseconds = static_cast<uint64_t>(value * unit + 0.5);
+
+    return true;
+}
+
+/*
+ * setrlimit() is the fallback when the service is not in its cgroup,
+ * it is per process (per user for RLIMIT_NPROC) where the cgroup is per tree:
+ *     memory.max -> RLIMIT_DATA, pids.max -> RLIMIT_NPROC
+ * memory.high, cpu.max, cpu.weight and io.weight have no rlimit
+ */
+static void make_spawn_limits(const cgroup_limits_t & limits, std::vector<SpawnLimit> & spawn_limits)
 {
-    Stupid::Base::Xml xml;
+    spawn_limits.clear();
 
-    if (!xml.set_document(service_conf.c_str()))
+#ifndef _MSC_VER
+    SpawnLimit spawn_limit;
+
+    cgroup_limits_t::const_iterator iter = limits.find("memory.max");
+    if (limits.end() != iter && parse_memory_size(iter->second, spawn_limit.value))
+    {
+        spawn_limit.resource = RLIMIT_DATA;
+        spawn_limits.push_back(spawn_limit);
+    }
+
+    iter = limits.find("pids.max");
+    if (limits.end() != iter && Stupid::Base::stupid_string_to_type(iter->second, spawn_limit.value))
+    {
+        spawn_limit.resource = RLIMIT_NPROC;
+        spawn_limits.push_back(spawn_limit);
+    }
+#endif // _MSC_VER
+}
+
+static bool set_mask_bits(const std::vector<size_t> & bits, uint64_t * mask)
+{
+    memset(mask, 0, sizeof(uint64_t) * SpawnScheduling::mask_words);
+    for (std::vector<size_t>::const_iterator iter = bits.begin(); bits.end() != iter; ++iter)
+    {
+        if (*iter >= SpawnScheduling::mask_words * 64)
+        {
+            return false;
+        }
+        mask[*iter / 64] |= (static_cast<uint64_t>(1) << (*iter % 64));
+    }
+    return !bits.empty();
+}
+
+/*
+ * the config is read in place with one CMarkup, the helpers below look for
+ * a child of the element which the markup is in, from its first child
+ */
+static bool get_element(CMarkup & markup, const char * name, std::string & value)
+{
+    markup.ResetMainPos();
+    if (!markup.FindElem(name))
     {
-        RUN_LOG_CRI("set document failed, content:{%s}", service_conf.c_str());
         return false;
     }
+    value = markup.GetData();
+    return true;
+}
+
+static bool into_element(CMarkup & markup, const char * name)
+{
+    markup.ResetMainPos();
+    return (markup.FindElem(name) && markup.IntoElem());
+}
+
+static void get_element_block(CMarkup & markup, const char * block, const char * name, std::list<std::string> & values)
+{
+    values.clear();
+    if (!into_element(markup, block))
+    {
+        return;
+    }
+    while (markup.FindElem(name))
+    {
+        values.push_back(markup.GetData());
+    }
+    markup.OutOfElem();
+}
+
+/*
+ * <scheduling> of a service, every element is optional:
+ *     <cpus>node 1, physical</cpus>    see CpuTopology
+ *     <numa>bind 1</numa>              bind | preferred | interleave <nodes>, local, default
+ *     <nice>-5</nice>                  -20 ~ 19
+ *     <ioprio>be 2</ioprio>            rt | be <0 ~ 7>, idle
+ *     <policy>fifo 10</policy>         other, batch, idle, fifo | rr <1 ~ 99>
+ */
+static bool parse_scheduling(CMarkup & markup, CpuTopology & cpu_topology, SpawnScheduling & scheduling)
+{
+    memset(&scheduling, 0, sizeof(scheduling));
+    scheduling.numa_mode = -1;
+    scheduling.ioprio = -1;
+    scheduling.policy = -1;
+
+#ifdef _MSC_VER
+    return true;
+#else
+    std::string cpus;
+    if (get_element(markup, "cpus", cpus) && !cpus.empty())
+    {
+        if (cpu_topology.empty() && !cpu_topology.load())
+        {
+            return false;
+        }
+
+        std::vector<size_t> cpu_list;
+        if (!cpu_topology.resolve(cpus, cpu_list))
+        {
+            return false;
+        }
+        if (!set_mask_bits(cpu_list, scheduling.cpu_mask))
+        {
+            RUN_LOG_ERR("bad <cpus> {%s}", cpus.c_str());
+            return false;
+        }
+        scheduling.set_cpus = true;
+    }
+
+    std::string numa;
+    if (get_element(markup, "numa", numa) && !numa.empty())
+    {
+        std::istringstream iss(numa);
+        std::string mode;
+        std::string nodes;
+        iss >> mode;
+        std::getline(iss, nodes);
+
+        std::vector<size_t> node_list;
+        if ("default" == mode)
+        {
+            scheduling.numa_mode = MPOL_DEFAULT;
+        }
+        else if ("local" == mode)
+        {
+            scheduling.numa_mode = MPOL_LOCAL;
+        }
+        else if (("bind" == mode || "preferred" == mode || "interleave" == mode) && parse_cpu_list(nodes, node_list) && set_mask_bits(node_list, scheduling.node_mask))
+        {
+            scheduling.numa_mode = ("bind" == mode ? MPOL_BIND : "preferred" == mode ? MPOL_PREFERRED : MPOL_INTERLEAVE);
+        }
+        else
+        {
+            RUN_LOG_ERR("bad <numa> {%s}", numa.c_str());
+            return false;
+        }
+    }
+
+    std::string nice;
+    if (get_element(markup, "nice", nice) && !nice.empty())
+    {
+        if (!Stupid::Base::stupid_string_to_type(nice, scheduling.nice) || scheduling.nice < -20 || scheduling.nice > 19)
+        {
+            RUN_LOG_ERR("bad <nice> {%s}", nice.c_str());
+            return false;
+        }
+        scheduling.set_nice = true;
+    }
+
+    std::string ioprio;
+    if (get_element(markup, "ioprio", ioprio) && !ioprio.empty())
+    {
+        std::istringstream iss(ioprio);
+        std::string io_class;
+        int level = 0;
+        iss >> io_class;
+        if ("idle" == io_class)
+        {
+            scheduling.ioprio = (3 << 13);
+        }
+        else if (("rt" == io_class || "be" == io_class) && (iss >> level) && level >= 0 && level <= 7)
+        {
+            scheduling.ioprio = (("rt" == io_class ? 1 : 2) << 13) | level;
+        }
+        else
+        {
+            RUN_LOG_ERR("bad <ioprio> {%s}", ioprio.c_str());
+            return false;
+        }
+    }
+
+    std::string policy;
+    if (get_element(markup, "policy", policy) && !policy.empty())
+    {
+        std::istringstream iss(policy);
+        std::string name;
+        iss >> name;
+        if ("other" == name)
+        {
+            scheduling.policy = SCHED_OTHER;
+        }
+        else if ("batch" == name)
+        {
+            scheduling.policy = SCHED_BATCH;
+        }
+        else if ("idle" == name)
+        {
+            scheduling.policy = SCHED_IDLE;
+        }
+        else if (("fifo" == name || "rr" == name) && (iss >> scheduling.priority) && scheduling.priority >= 1 && scheduling.priority <= 99)
+        {
+            scheduling.policy = ("fifo" == name ? SCHED_FIFO : SCHED_RR);
+        }
+        else
+        {
+            RUN_LOG_ERR("bad <policy> {%s}", policy.c_str());
+            return false;
+        }
+    }
+
+    return true;
+#endif // _MSC_VER
+}
+
+/*
+ * <probe type="http">
+ *     <port>8080</port>                  (optional, every port of the service if not set)
+ *     <path>/health</path>               (default /)
+ *     <status>200</status>               (default 200)
+ *     <body>ok</body>                    (optional, a text the body has)
+ *     <timeout>1000</timeout>            (optional, milliseconds, <probe_timeout> if not set)
+ * </probe>
+ * the markup is in the <service>, and is left there
+ */
+static bool parse_probe(CMarkup & markup, ServiceInfo & service_info)
+{
+    service_info.probe_http = false;
+    service_info.probe_path = "/";
+    service_info.probe_status = 200;
+
+    markup.ResetMainPos();
+    if (!markup.FindElem("probe"))
+    {
+        return true;
+    }
 
-    if (!xml.into_element("service"))
+    std::string type(markup.GetAttrib("type"));
+    Stupid::Base::stupid_string_trim(type, " \t\r\n");
+    if (type.empty() || "tcp" == type)
     {
-        RUN_LOG_CRI("into element <%s> failed", "service");
+        return true;
+    }
+    if ("http" != type)
+    {
+        RUN_LOG_ERR("unknown probe type {%s}", type.c_str());
         return false;
     }
 
+    service_info.probe_http = true;
+
+    markup.IntoElem();
+
+    bool ret = true;
+
+    if (get_element(markup, "port", service_info.probe_port))
+    {
+        Stupid::Base::stupid_string_trim(service_info.probe_port, " \t\r\n");
+    }
+
+    std::string path;
+    if (get_element(markup, "path", path))
+    {
+        Stupid::Base::stupid_string_trim(path, " \t\r\n");
+        if (!path.empty())
+        {
+            service_info.probe_path = ('/' == path[0] ? path : "/" + path);
+        }
+    }
+
+    std::string status;
+    if (get_element(markup, "status", status))
+    {
+        int status_code = 0;
+        if (!Stupid::Base::stupid_string_to_type(status, status_code) || status_code < 100 || status_code > 599)
+        {
+            RUN_LOG_ERR("bad probe status {%s}", status.c_str());
+            ret = false;
+        }
+        else
+        {
+            service_info.probe_status = status_code;
+        }
+    }
+
+    get_element(markup, "body", service_info.probe_body);
+
+    std::string timeout;
+    if (get_element(markup, "timeout", timeout))
+    {
+        uint64_t timeout_ms = 0;
+        if (Stupid::Base::stupid_string_to_type(timeout, timeout_ms) && 0 != timeout_ms)
+        {
+            service_info.probe_timeout = timeout_ms;
+        }
+    }
+
+    markup.OutOfElem();
+
+    return ret;
+}
+
+/* the markup is in the <service>, and is left there */
+static bool parse_item(CMarkup & markup, CpuTopology & cpu_topology, ServiceInfo & service_info)
+{
     std::string show;
-    if (!xml.get_element("show", show) || !Stupid::Base::stupid_string_to_type(show, service_info.show))
+    if (!get_element(markup, "show", show) || !Stupid::Base::stupid_string_to_type(show, service_info.show))
     {
         service_info.show = false;
     }
 
-    if (!xml.get_element("host", service_info.host) || service_info.host.empty())
+    if (!get_element(markup, "host", service_info.host) || service_info.host.empty())
     {
         service_info.host = "127.0.0.1";
     }
 
-    xml.get_element_block("ports", "port", true, service_info.ports);
+    get_element_block(markup, "ports", "port", service_info.ports);
 
-    if (!xml.get_element("path", service_info.path))
+    if (!get_element(markup, "path", service_info.path))
     {
         RUN_LOG_ERR("get element <%s> failed", "path");
         return false;
@@ -76,7 +466,7 @@ static bool parse_item(const std::string & service_conf, ServiceInfo & service_i
         service_info.path += '/';
     }
 
-    if (!xml.get_element("file", service_info.file))
+    if (!get_element(markup, "file", service_info.file))
     {
         RUN_LOG_ERR("get element <%s> failed", "file");
         return false;
@@ -97,7 +487,7 @@ static bool parse_item(const std::string & service_conf, ServiceInfo & service_i
     }
 #endif // _MSC_VER
 
-    xml.get_element_block("params", "param", true, service_info.params);
+    get_element_block(markup, "params", "param", service_info.params);
     std::string params;
     Stupid::Base::stupid_piece_together(service_info.params.begin(), service_info.params.end(), " ", params);
     if (!params.empty())
@@ -105,97 +495,285 @@ static bool parse_item(const std::string & service_conf, ServiceInfo & service_i
         service_info.cmdl += " " + params;
     }
 
-    return true;
-}
+    get_element_block(markup, "envs", "env", service_info.envs);
 
-static bool load_services(const std::string & root_directory, std::list<ServiceInfo> & service_info_list)
-{
-    const std::string config_file(root_directory + "cfg/config.xml");
+    std::string stop_timeout;
+    if (!get_element(markup, "stop_timeout", stop_timeout) || !Stupid::Base::stupid_string_to_type(stop_timeout, service_info.stop_timeout))
+    {
+        service_info.stop_timeout = 5;
+    }
 
-    Stupid::Base::Xml xml;
+    /* see parse_duration, the global <check_interval> if not set */
+    std::string check_interval;
+    if (!get_element(markup, "check_interval", check_interval) || !parse_duration(check_interval, service_info.check_interval))
+    {
+        service_info.check_interval = 0;
+    }
+    else
+    {
+        service_info.check_interval = std::max(s_min_check_interval, std::min(service_info.check_interval, s_max_check_interval));
+    }
 
-    if (!xml.load(config_file.c_str()))
+    /* see parse_duration, a random delay up to it is added to every interval */
+    std::string check_jitter;
+    if (!get_element(markup, "check_jitter", check_jitter) || !parse_duration(check_jitter, service_info.check_jitter))
     {
-        RUN_LOG_CRI("load failed, filename:{%s}", config_file.c_str());
-        return false;
+        service_info.check_jitter = UINT64_MAX;
     }
 
-    if (!xml.into_element("root"))
+    /* milliseconds, every port of the service has its own deadline */
+    std::string probe_timeout;
+    if (!get_element(markup, "probe_timeout", probe_timeout) || !Stupid::Base::stupid_string_to_type(probe_timeout, service_info.probe_timeout) || 0 == service_info.probe_timeout)
     {
-        RUN_LOG_CRI("into element <%s> failed", "root");
-        return false;
+        service_info.probe_timeout = 3000;
     }
 
-    if (!xml.into_element("services"))
+    /* keep the probe connections open, see ProbeEngine */
+    std::string probe_persistent;
+    if (!get_element(markup, "probe_persistent", probe_persistent) || !Stupid::Base::stupid_string_to_type(probe_persistent, service_info.probe_persistent))
     {
-        RUN_LOG_CRI("into element <%s> failed", "services");
+        service_info.probe_persistent = false;
+    }
+
+    /* a local service may be checked by its listen sockets, see ListenTable */
+    std::string probe_listen;
+    if (!get_element(markup, "probe_listen", probe_listen) || !Stupid::Base::stupid_string_to_type(probe_listen, service_info.probe_listen))
+    {
+        service_info.probe_listen = false;
+    }
+
+    std::string probe_owner;
+    if (!get_element(markup, "probe_owner", probe_owner) || !Stupid::Base::stupid_string_to_type(probe_owner, service_info.probe_owner))
+    {
+        service_info.probe_owner = false;
+    }
+
+    if (!parse_probe(markup, service_info))
+    {
+        RUN_LOG_ERR("bad <probe> of service {%s}", service_info.cmdl.c_str());
         return false;
     }
 
-    std::string sub_document;
-    while (xml.get_sub_document(sub_document))
+    /*
+     * the leaf cgroup is named by the file and a hash of the command line,
+     * so it is the same cgroup after a restart of the daemon
+     */
     {
-        ServiceInfo service_info;
-        if (parse_item(sub_document, service_info))
+        std::string file_name(service_info.file);
+        for (std::string::iterator iter = file_name.begin(); file_name.end() != iter; ++iter)
         {
-            service_info_list.push_back(service_info);
+            if (!isalnum(static_cast<unsigned char>(*iter)) && '.' != *iter && '-' != *iter)
+            {
+                *iter = '_';
+            }
+        }
+
+        uint32_t hash = 2166136261U;
+        for (std::string::const_iterator iter = service_info.cmdl.begin(); service_info.cmdl.end() != iter; ++iter)
+        {
+            hash ^= static_cast<unsigned char>(*iter);
+            hash *= 16777619U;
         }
+
+        std::ostringstream oss;
+        oss << file_name << "-" << std::hex << std::setw(8) << std::setfill('0') << hash;
+        service_info.cgroup = oss.str();
     }
 
-    if (!xml.outof_element())
+    if (into_element(markup, "limits"))
     {
-        RUN_LOG_ERR("out of element failed");
-        return false;
+        static const char * const limit_names[] =
+        {
+            "memory.max", "memory.high", "cpu.max", "cpu.weight", "io.weight", "pids.max"
+        };
+
+        for (size_t index = 0; index < sizeof(limit_names) / sizeof(limit_names[0]); ++index)
+        {
+            std::string limit;
+            if (get_element(markup, limit_names[index], limit))
+            {
+                Stupid::Base::stupid_string_trim(limit, " \t\r\n");
+                if (!limit.empty())
+                {
+                    service_info.limits[limit_names[index]] = limit;
+                }
+            }
+        }
+
+        markup.OutOfElem();
     }
 
-    if (!xml.outof_element())
+#ifndef _MSC_VER
+    if (!service_info.launch_spec.build(service_info.path, service_info.file, service_info.params, service_info.envs))
     {
-        RUN_LOG_ERR("out of element failed");
+        RUN_LOG_ERR("build launch spec failed: {%s}", service_info.cmdl.c_str());
         return false;
     }
 
+    std::vector<SpawnLimit> spawn_limits;
+    make_spawn_limits(service_info.limits, spawn_limits);
+    service_info.launch_spec.set_limits(spawn_limits);
+
+    if (into_element(markup, "scheduling"))
+    {
+        SpawnScheduling scheduling;
+        bool ret = parse_scheduling(markup, cpu_topology, scheduling);
+        markup.OutOfElem();
+        if (!ret)
+        {
+            RUN_LOG_ERR("bad <scheduling> of service {%s}", service_info.cmdl.c_str());
+            return false;
+        }
+        service_info.launch_spec.set_scheduling(scheduling);
+    }
+#endif // _MSC_VER
+
     return true;
 }
 
-static void get_check_interval(const std::string & root_directory, uint64_t & check_interval_seconds)
+/*
+ * cfg/config.xml, parsed once when the file is written
+ * (see Daemon::reload_services), the checks only look up in it;
+ * a table is not changed after it is loaded, a reload makes a new one
+ *
+ * the root settings but <check_interval> are taken from the table
+ * which is loaded at start, a reload does not change them
+ */
+struct ServiceTable
 {
-    const uint64_t min_interval_seconds = 3;
-    const uint64_t def_interval_seconds = 30;
-    const uint64_t max_interval_seconds = 300;
+    uint64_t                         check_interval; /* nanoseconds, of a service without its own */
+    bool                             proc_connector;
+    bool                             cgroup;
+    uint64_t                         resolve_ttl;    /* seconds */
+    uint64_t                         sample_interval;/* seconds */
+    size_t                           sample_history;
+    std::vector<ServiceInfo>         services;       /* in the order of the config */
+    std::map<std::string, size_t>    index_map;      /* cmdl -> index of services, the first one wins */
+    std::map<std::string, std::vector<size_t> > endpoint_map; /* "host:port" -> indexes of services on it */
 
-    check_interval_seconds = def_interval_seconds;
+    ServiceTable()
+        : check_interval(30ULL * 1000000000)
+        , proc_connector(false)
+        , cgroup(true)
+        , resolve_ttl(300)
+        , sample_interval(10)
+        , sample_history(60)
+        , services()
+        , index_map()
+        , endpoint_map()
+    {
 
-    const std::string config_file(root_directory + "cfg/config.xml");
+    }
+};
 
-    Stupid::Base::Xml xml;
+/* the endpoints of the services are not resolved here, see Daemon::install_services */
+static bool load_service_table(const std::string & config_content, ServiceTable & service_table)
+{
+    CMarkup markup;
 
-    if (!xml.load(config_file.c_str()))
+    if (!markup.SetDoc(config_content))
     {
-        RUN_LOG_ERR("load failed, filename:{%s}", config_file.c_str());
-        return;
+        RUN_LOG_CRI("set document failed, content:{%s}", config_content.c_str());
+        return false;
     }
 
-    if (!xml.find_element("root"))
+    if (!markup.FindElem("root") || !markup.IntoElem())
     {
-        RUN_LOG_ERR("find element <%s> failed", "root");
-        return;
+        RUN_LOG_CRI("into element <%s> failed", "root");
+        return false;
     }
 
+    /* see parse_duration */
     std::string check_interval;
-    xml.get_child_element("check_interval", check_interval);
-    if (!check_interval.empty())
+    if (get_element(markup, "check_interval", check_interval) && !check_interval.empty() && !parse_duration(check_interval, service_table.check_interval))
+    {
+        RUN_LOG_ERR("<check_interval> {%s} is invalid", check_interval.c_str());
+    }
+    service_table.check_interval = std::max(s_min_check_interval, std::min(service_table.check_interval, s_max_check_interval));
+
+    std::string value;
+    if (get_element(markup, "proc_connector", value) && !value.empty())
+    {
+        Stupid::Base::stupid_string_to_type(value, service_table.proc_connector);
+    }
+
+    value.clear();
+    if (get_element(markup, "cgroup", value) && !value.empty())
+    {
+        Stupid::Base::stupid_string_to_type(value, service_table.cgroup);
+    }
+
+    value.clear();
+    if (get_element(markup, "resolve_ttl", value) && !value.empty())
+    {
+        Stupid::Base::stupid_string_to_type(value, service_table.resolve_ttl);
+    }
+    if (0 == service_table.resolve_ttl)
+    {
+        service_table.resolve_ttl = 1;
+    }
+
+    value.clear();
+    if (get_element(markup, "sample_interval", value) && !value.empty())
+    {
+        Stupid::Base::stupid_string_to_type(value, service_table.sample_interval);
+    }
+
+    value.clear();
+    if (get_element(markup, "sample_history", value) && !value.empty())
+    {
+        Stupid::Base::stupid_string_to_type(value, service_table.sample_history);
+    }
+
+    if (!into_element(markup, "services"))
+    {
+        RUN_LOG_CRI("into element <%s> failed", "services");
+        return false;
+    }
+
+    /* loaded by the first service which asks for it */
+    CpuTopology cpu_topology;
+
+    /* every <service> is read where it is, the document is parsed only once */
+    while (markup.FindElem("service"))
     {
-        Stupid::Base::stupid_string_to_type(check_interval, check_interval_seconds);
+        markup.IntoElem();
+        ServiceInfo service_info;
+        const bool ret = parse_item(markup, cpu_topology, service_info);
+        markup.OutOfElem();
+        if (ret)
+        {
+            service_table.index_map.insert(std::make_pair(service_info.cmdl, service_table.services.size()));
+            service_table.services.push_back(service_info);
+        }
     }
 
-    if (check_interval_seconds < min_interval_seconds)
+    return true;
+}
+
+static bool read_file(const std::string & file, std::string & content)
+{
+    std::ifstream ifs(file.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.is_open())
     {
-        check_interval_seconds = min_interval_seconds;
+        return false;
     }
-    else if (check_interval_seconds > max_interval_seconds)
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    content = oss.str();
+    return !ifs.bad();
+}
+
+/* FNV-1a, an editor which saves the same text does not reload the services */
+static uint64_t hash_content(const std::string & content)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (std::string::const_iterator iter = content.begin(); content.end() != iter; ++iter)
     {
-        check_interval_seconds = max_interval_seconds;
+        hash ^= static_cast<unsigned char>(*iter);
+        hash *= 1099511628211ULL;
     }
+    return hash;
 }
 
 static void append_record_content(const std::string & record_file, const std::string & record_content)
@@ -216,17 +794,37 @@ Daemon::Daemon()
     : m_running(false)
     , m_root_directory()
     , m_record_file()
-    , m_last_check_time(0)
-    , m_check_interval(0)
+    , m_service_table(new ServiceTable)
+    , m_config_hash(0)
+    , m_config_watcher()
+    , m_check_scheduler()
+    , m_check_overrun_map()
+    , m_restart_delay_map()
+    , m_restart_set()
     , m_process_info_map()
+    , m_process_snapshot()
+    , m_process_watcher()
+    , m_cgroup_manager()
+    , m_process_stopper(m_cgroup_manager)
+    , m_resource_sampler()
+    , m_probe_engine()
+    , m_probe_check_map()
+    , m_endpoint_resolver()
+    , m_listen_table()
+#ifdef _MSC_VER
     , m_check_timer()
+#else
+    , m_event_loop()
+    , m_event_thread()
+    , m_event_thread_started(false)
+#endif // _MSC_VER
 {
 
 }
 
 Daemon::~Daemon()
 {
-
+    delete m_service_table;
 }
 
 bool Daemon::init(const std::string & current_work_directory)
@@ -241,13 +839,114 @@ bool Daemon::init(const std::string & current_work_directory)
     Stupid::Base::stupid_create_directory_recursive(m_record_file);
     m_record_file += Stupid::Base::stupid_get_date() + ".txt";
 
-    get_check_interval(m_root_directory, m_check_interval);
+    m_check_scheduler.clear();
+    m_check_overrun_map.clear();
+    m_restart_delay_map.clear();
+    m_restart_set.clear();
+    delete m_service_table;
+    m_service_table = new ServiceTable;
+    m_config_hash = 0;
+
+    /*
+     * the config is loaded once here, the parts below take their settings
+     * from it, and it is installed when the endpoint resolver is up,
+     * every service in it is checked then
+     */
+    const std::string config_file(m_root_directory + "cfg/config.xml");
+    std::string config_content;
+    uint64_t config_hash = 0;
+    ServiceTable * service_table = new ServiceTable;
+    if (read_file(config_file, config_content) && load_service_table(config_content, *service_table))
+    {
+        config_hash = hash_content(config_content);
+    }
+    else
+    {
+        RUN_LOG_ERR("load services failed, filename:{%s}, start with no service", config_file.c_str());
+        delete service_table;
+        service_table = new ServiceTable;
+    }
+
+    if (!m_process_watcher.init())
+    {
+        RUN_LOG_CRI("process watcher init failed");
+        delete service_table;
+        return false;
+    }
+
+    if (service_table->proc_connector && !m_process_snapshot.open_event_stream())
+    {
+        RUN_LOG_ERR("process event stream is unavailable, fall back to scan /proc");
+    }
+
+    if (service_table->cgroup && !m_cgroup_manager.init())
+    {
+        RUN_LOG_ERR("cgroup manager init failed, services are stopped by process group");
+    }
+
+    if (!m_probe_engine.init())
+    {
+        RUN_LOG_CRI("probe engine init failed");
+        delete service_table;
+        return false;
+    }
+
+    if (!m_endpoint_resolver.init(service_table->resolve_ttl * 1000))
+    {
+        RUN_LOG_CRI("endpoint resolver init failed");
+        delete service_table;
+        return false;
+    }
+
+    m_resource_sampler.init(service_table->sample_interval * 1000, service_table->sample_history);
+
+    install_services(service_table, config_hash);
+
+    /*
+     * the services are loaded again when config.xml is written,
+     * without inotify the file is read at every global interval
+     */
+    if (!m_config_watcher.init(m_root_directory + "cfg", "config.xml"))
+    {
+        RUN_LOG_ERR("config watcher is unavailable, the config is read at every check interval");
+    }
+
+    if (!m_listen_table.init())
+    {
+        RUN_LOG_ERR("listen table is unavailable, <probe_listen> services are connected to");
+    }
 
+#ifdef _MSC_VER
     if (!m_check_timer.init(this, 30))
     {
         RUN_LOG_CRI("check timer init failed");
         return false;
     }
+#else
+    /*
+     * the daemon thread sleeps until one of these fds is readable,
+     * or until the next check, probe deadline, stop deadline, sample or endpoint refresh
+     */
+    if (!m_event_loop.init())
+    {
+        RUN_LOG_CRI("event loop init failed");
+        return false;
+    }
+    m_event_loop.add(m_process_watcher.event_fd());
+    m_event_loop.add(m_process_snapshot.event_fd());
+    m_event_loop.add(m_cgroup_manager.event_fd());
+    m_event_loop.add(m_probe_engine.probe_fd());
+    m_event_loop.add(m_probe_engine.event_fd());
+    m_event_loop.add(m_endpoint_resolver.event_fd());
+    m_event_loop.add(m_config_watcher.event_fd());
+
+    if (0 != ::pthread_create(&m_event_thread, nullptr, event_loop_thread, this))
+    {
+        RUN_LOG_CRI("create event loop thread failed");
+        return false;
+    }
+    m_event_thread_started = true;
+#endif // _MSC_VER
 
     append_record_content(m_record_file, "--------- daemon init ---------");
 
@@ -265,7 +964,34 @@ void Daemon::exit()
 
     m_running = false;
 
+#ifdef _MSC_VER
     m_check_timer.exit();
+#else
+    if (m_event_thread_started)
+    {
+        m_event_loop.wake();
+        ::pthread_join(m_event_thread, nullptr);
+        m_event_thread_started = false;
+    }
+    m_event_loop.exit();
+#endif // _MSC_VER
+
+    m_process_watcher.exit();
+
+    m_process_snapshot.close_event_stream();
+
+    m_probe_engine.exit();
+    m_probe_check_map.clear();
+
+    m_endpoint_resolver.exit();
+
+    m_config_watcher.exit();
+
+    m_listen_table.exit();
+
+    m_resource_sampler.exit();
+
+    m_cgroup_manager.exit();
 
     append_record_content(m_record_file, "--------- daemon exit ---------");
 
@@ -274,86 +1000,714 @@ void Daemon::exit()
 
 void Daemon::on_timer(bool first_time, size_t index)
 {
-    if (Stupid::Base::stupid_time() < m_last_check_time + m_check_interval)
+    m_cgroup_manager.update();
+
+    check_exited_services();
+
+    m_process_snapshot.update();
+
+    check_died_services();
+
+    m_resource_sampler.sample(get_monotonic_milliseconds());
+
+    m_endpoint_resolver.update(get_monotonic_milliseconds());
+
+    const uint64_t now_ns = get_monotonic_nanoseconds();
+
+    /*
+     * here no service of the table is held (a check which waits for its
+     * probes keeps the command line only), so a new service table
+     * can be taken (see reload_services); if the directory is not
+     * watched (or never was), the reload task reads the file again
+     * at the global interval
+     */
+    if (m_config_watcher.update())
+    {
+        reload_services();
+    }
+    if (!m_config_watcher.is_open() && !m_check_scheduler.has(s_reload_task))
+    {
+        m_check_scheduler.schedule(s_reload_task, now_ns + m_service_table->check_interval);
+    }
+
+    /* the services on a dropped probe connection are checked at once, not at their next interval */
+    std::vector<std::string> dropped_list;
+    m_probe_engine.update(dropped_list);
+    for (std::vector<std::string>::const_iterator iter = dropped_list.begin(); dropped_list.end() != iter; ++iter)
+    {
+        RUN_LOG_DBG("probe connection to %s is closed", iter->c_str());
+        std::map<std::string, std::vector<size_t> >::const_iterator iter_endpoint = m_service_table->endpoint_map.find(*iter);
+        if (m_service_table->endpoint_map.end() == iter_endpoint)
+        {
+            continue;
+        }
+        for (std::vector<size_t>::const_iterator iter_index = iter_endpoint->second.begin(); iter_endpoint->second.end() != iter_index; ++iter_index)
+        {
+            const std::string & cmdl = m_service_table->services[*iter_index].cmdl;
+            if (m_restart_set.end() == m_restart_set.find(cmdl))
+            {
+                m_check_scheduler.schedule(cmdl, now_ns);
+            }
+        }
+    }
+
+    /* the services whose last probe is done are judged, see check_services */
+    check_probes();
+
+    if (now_ns < m_check_scheduler.next_due_time())
+    {
+        return;
+    }
+
+    check_services(now_ns);
+}
+
+uint64_t Daemon::next_event_time()
+{
+    /* the others keep their deadlines in milliseconds */
+    uint64_t next_time_ms = m_process_stopper.next_check_time();
+    next_time_ms = std::min(next_time_ms, m_probe_engine.next_deadline());
+    next_time_ms = std::min(next_time_ms, m_resource_sampler.next_sample_time());
+    next_time_ms = std::min(next_time_ms, m_endpoint_resolver.next_expire_time());
+
+    uint64_t next_time = m_check_scheduler.next_due_time();
+    if (UINT64_MAX != next_time_ms)
+    {
+        next_time = std::min(next_time, next_time_ms * 1000000);
+    }
+    return next_time;
+}
+
+void Daemon::reload_services()
+{
+    const std::string config_file(m_root_directory + "cfg/config.xml");
+
+    std::string config_content;
+    if (!read_file(config_file, config_content))
     {
+        RUN_LOG_ERR("read failed, filename:{%s}, keep the %u services loaded before", config_file.c_str(), m_service_table->services.size());
         return;
     }
 
-    std::list<ServiceInfo> service_info_list;
-    if (!load_services(m_root_directory, service_info_list))
+    /* the table is kept while the text is the same */
+    const uint64_t config_hash = hash_content(config_content);
+    if (0 != m_config_hash && config_hash == m_config_hash)
     {
-        RUN_LOG_ERR("load services failed");
+        RUN_LOG_DBG("config is not changed");
         return;
     }
 
-    for (std::list<ServiceInfo>::const_iterator iter = service_info_list.begin(); service_info_list.end() != iter; ++iter)
+    ServiceTable * service_table = new ServiceTable;
+    if (!load_service_table(config_content, *service_table))
     {
-        std::map<std::string, ProcessInfo>::iterator iter_proc = m_process_info_map.find(iter->cmdl);
-        bool service_is_ok = true;
+        RUN_LOG_ERR("load services failed, keep the %u services loaded before", m_service_table->services.size());
+        delete service_table;
+        return;
+    }
+
+    install_services(service_table, config_hash);
+}
+
+void Daemon::install_services(ServiceTable * service_table, uint64_t config_hash)
+{
+    for (size_t index = 0; index < service_table->services.size(); ++index)
+    {
+        ServiceInfo & service_info = service_table->services[index];
+        for (std::list<std::string>::const_iterator iter_port = service_info.ports.begin(); service_info.ports.end() != iter_port; ++iter_port)
+        {
+            const Endpoint & endpoint = m_endpoint_resolver.get(service_info.host, *iter_port);
+            service_info.endpoints.push_back(&endpoint);
+            service_table->endpoint_map[endpoint.key].push_back(index);
+        }
+    }
+
+    /* no one holds a service of the old table, see on_timer */
+    delete m_service_table;
+    m_service_table = service_table;
+    m_config_hash = config_hash;
+
+    /* due at 0: checked at once, see check_services */
+    std::set<std::string> endpoint_key_set;
+    for (std::vector<ServiceInfo>::const_iterator iter = m_service_table->services.begin(); m_service_table->services.end() != iter; ++iter)
+    {
+        if (!m_check_scheduler.has(iter->cmdl))
+        {
+            m_check_scheduler.schedule(iter->cmdl, 0);
+        }
+        for (std::vector<const Endpoint *>::const_iterator iter_endpoint = iter->endpoints.begin(); iter->endpoints.end() != iter_endpoint; ++iter_endpoint)
+        {
+            endpoint_key_set.insert((*iter_endpoint)->key);
+        }
+    }
+
+    /* the kept probe connections of endpoints which are gone from the config */
+    m_probe_engine.retain(endpoint_key_set);
+
+    RUN_LOG_DBG("%u services are loaded", m_service_table->services.size());
+}
+
+uint64_t Daemon::next_check_time(const std::string & key, uint64_t due_time, uint64_t interval, uint64_t now)
+{
+    /*
+     * the next check is one interval after the time this one was due,
+     * not after now, so a late tick does not push every later check back;
+     * if the check is later than the whole interval (the last check ran
+     * longer than its period), the periods which are missed are skipped
+     * and counted, and the next check is at the next period boundary
+     */
+    uint64_t next_time = due_time + interval;
+    if (next_time <= now)
+    {
+        const uint64_t missed = (now - due_time) / interval;
+        next_time = due_time + (missed + 1) * interval;
+
+        uint64_t & overrun = m_check_overrun_map[key];
+        overrun += missed;
+        RUN_LOG_DBG("check of {%s} is late by %u.%03ums, %u periods missed, %u in total", key.c_str(), static_cast<size_t>((now - due_time) / 1000000), static_cast<size_t>((now - due_time) / 1000 % 1000), static_cast<size_t>(missed), static_cast<size_t>(overrun));
+    }
+    return next_time;
+}
+
+#ifndef _MSC_VER
+
+void * Daemon::event_loop_thread(void * argument)
+{
+    Daemon * daemon = reinterpret_cast<Daemon *>(argument);
+
+    bool first_time = true;
+    while (daemon->m_running)
+    {
+        daemon->on_timer(first_time, 0);
+        first_time = false;
+
+        if (daemon->m_running && !daemon->m_event_loop.wait(daemon->next_event_time()))
+        {
+            /* the loop is broken, keep on as the old timer did */
+            ::usleep(30 * 1000);
+        }
+    }
+
+    return nullptr;
+}
+
+#endif // _MSC_VER
+
+bool Daemon::start_service(const std::string & cmdl, ProcessInfo process_info)
+{
+    int cgroup_procs_fd = -1;
+    bool limits_in_cgroup = false;
+    if (m_cgroup_manager.is_available() && m_cgroup_manager.create(process_info.cgroup))
+    {
+        cgroup_procs_fd = m_cgroup_manager.procs_fd(process_info.cgroup);
+        limits_in_cgroup = m_cgroup_manager.set_limits(process_info.cgroup, process_info.limits);
+        if (!limits_in_cgroup)
+        {
+            RUN_LOG_ERR("set cgroup limits of service {%s} failed, fall back to setrlimit", cmdl.c_str());
+        }
+    }
+
+    if (!create_process(process_info.launch_spec, cmdl, process_info.show, cgroup_procs_fd, limits_in_cgroup, process_info.identity, process_info.in_cgroup))
+    {
+        RUN_LOG_ERR("start service {%s} failure", cmdl.c_str());
+        append_record_content(m_record_file, "start process {" + cmdl + "} failed");
+        return false;
+    }
+
+    RUN_LOG_DBG("start service {%s} success", cmdl.c_str());
+    process_info.start_time = get_monotonic_nanoseconds();
+    m_process_info_map[cmdl] = process_info;
+    m_process_watcher.watch(process_info.identity.pid);
+    m_resource_sampler.track(cmdl, process_info.identity.pid, process_info.in_cgroup ? m_cgroup_manager.path(process_info.cgroup) : std::string());
+    append_record_content(m_record_file, "process {" + cmdl + "} is start");
+
+    return true;
+}
+
+void Daemon::check_exited_services()
+{
+    std::vector<ProcessExit> exit_list;
+    if (m_process_watcher.wait(0, exit_list))
+    {
+        for (std::vector<ProcessExit>::const_iterator iter = exit_list.begin(); exit_list.end() != iter; ++iter)
+        {
+            on_service_exit(*iter);
+        }
+    }
+
+    if (m_process_stopper.size() > 0)
+    {
+        std::vector<size_t> stopped_list;
+        m_process_stopper.check(get_monotonic_milliseconds(), stopped_list);
+        for (std::vector<size_t>::const_iterator iter = stopped_list.begin(); stopped_list.end() != iter; ++iter)
+        {
+            on_service_stopped(*iter);
+        }
+    }
+}
+
+void Daemon::check_died_services()
+{
+    std::vector<size_t> born_list;
+    std::vector<size_t> died_list;
+    m_process_snapshot.take_changes(born_list, died_list);
+
+    /*
+     * an exited child is reported by the process watcher already,
+     * this only finds a service which can not be watched (no pidfd)
+     */
+    for (std::vector<size_t>::const_iterator iter = died_list.begin(); died_list.end() != iter; ++iter)
+    {
+        for (std::map<std::string, ProcessInfo>::const_iterator iter_proc = m_process_info_map.begin(); m_process_info_map.end() != iter_proc; ++iter_proc)
+        {
+            if (iter_proc->second.identity.pid != *iter)
+            {
+                continue;
+            }
+
+            if (!m_process_stopper.is_stopping(*iter) && !is_process_alive(iter_proc->second.identity))
+            {
+                ProcessExit process_exit = { *iter, false, -1, 0, 0, 0 };
+                on_service_exit(process_exit);
+            }
 
-        if (iter->ports.empty())
+            break;
+        }
+    }
+}
+
+void Daemon::on_service_exit(const ProcessExit & process_exit)
+{
+    for (std::map<std::string, ProcessInfo>::iterator iter_proc = m_process_info_map.begin(); m_process_info_map.end() != iter_proc; ++iter_proc)
+    {
+        if (iter_proc->second.identity.pid != process_exit.pid)
         {
-            std::string process_name;
+            continue;
+        }
+
+        const std::string cmdl(iter_proc->first);
+        const ProcessInfo process_info(iter_proc->second);
+        m_process_watcher.unwatch(process_exit.pid);
+
+        std::string exit_status;
+        {
+            std::ostringstream oss;
+            if (0 != process_exit.signal)
+            {
+                oss << "killed by signal " << process_exit.signal;
+            }
+            else if (process_exit.reaped)
+            {
+                oss << "exit code " << process_exit.exit_code;
+            }
+            else
+            {
+                oss << "exit status unknown";
+            }
+            if (process_exit.reaped)
+            {
+                oss << ", cpu " << process_exit.cpu_time_ms << "ms, peak rss " << process_exit.max_rss / 1024 << "KB";
+            }
+            exit_status = oss.str();
+        }
+
+        m_resource_sampler.untrack(cmdl, process_exit);
+
+        RUN_LOG_DBG("service {%s} exited, %s", cmdl.c_str(), exit_status.c_str());
+        append_record_content(m_record_file, "process {" + cmdl + "} is exit, " + exit_status);
+
+        /* the stop is done when the whole tree is gone, see on_service_stopped */
+        if (m_process_stopper.is_stopping(process_exit.pid))
+        {
+            break;
+        }
+
+        /*
+         * processes forked by the service may be still alive and hold its ports,
+         * stop them before the service is started again
+         */
+        if (m_process_stopper.stop(process_info.identity, process_info.in_cgroup ? process_info.cgroup : std::string(), process_info.stop_timeout * 1000))
+        {
+            RUN_LOG_DBG("stop rest of service {%s} begin", cmdl.c_str());
+            break;
+        }
+
+        m_process_info_map.erase(iter_proc);
+
+        schedule_restart(cmdl, process_info.start_time);
+
+        break;
+    }
+}
+
+void Daemon::on_service_stopped(size_t process_id)
+{
+    for (std::map<std::string, ProcessInfo>::iterator iter_proc = m_process_info_map.begin(); m_process_info_map.end() != iter_proc; ++iter_proc)
+    {
+        if (iter_proc->second.identity.pid != process_id)
+        {
+            continue;
+        }
+
+        const std::string cmdl(iter_proc->first);
+        const uint64_t start_time = iter_proc->second.start_time;
+        m_process_info_map.erase(iter_proc);
+        m_process_watcher.unwatch(process_id);
+
+        /* gone without an exit event */
+        ProcessExit process_exit = { process_id, false, -1, 0, 0, 0 };
+        m_resource_sampler.untrack(cmdl, process_exit);
+
+        RUN_LOG_DBG("stop service {%s} end", cmdl.c_str());
+        append_record_content(m_record_file, "process {" + cmdl + "} is stop");
+
+        schedule_restart(cmdl, start_time);
+
+        break;
+    }
+}
+
+void Daemon::check_services(uint64_t now)
+{
+    std::vector<CheckScheduler::DueTask> due_list;
+    m_check_scheduler.take_due(now, due_list);
+
+    /* the reload task is done first, so the services below are taken from the new table */
+    for (std::vector<CheckScheduler::DueTask>::const_iterator iter = due_list.begin(); due_list.end() != iter; ++iter)
+    {
+        if (s_reload_task == iter->key)
+        {
+            reload_services();
+            /* only without the config watcher, see on_timer */
+            if (!m_config_watcher.is_open())
+            {
+                m_check_scheduler.schedule(s_reload_task, next_check_time(s_reload_task, iter->due_time, m_service_table->check_interval, now));
+            }
+        }
+    }
+
+    /*
+     * only the services which are due are checked, a service which is due
+     * at 0 is new to the scheduler (at start, or added to the config), its
+     * first next check is at a random point of the interval, so services
+     * with the same interval do not stay in one burst; a service which is
+     * gone from the config is not found in the table, and drops out
+     */
+    std::vector<const ServiceInfo *> service_list;
+    service_list.reserve(due_list.size());
+    for (std::vector<CheckScheduler::DueTask>::const_iterator iter = due_list.begin(); due_list.end() != iter; ++iter)
+    {
+        std::map<std::string, size_t>::const_iterator iter_index = m_service_table->index_map.find(iter->key);
+        if (m_service_table->index_map.end() == iter_index)
+        {
+            m_restart_set.erase(iter->key);
+            m_restart_delay_map.erase(iter->key);
+            continue;
+        }
+
+        const ServiceInfo & service_info = m_service_table->services[iter_index->second];
+
+        /* an exited service is started here when its restart delay is over, see schedule_restart */
+        if (m_restart_set.erase(service_info.cmdl) > 0)
+        {
+            const uint64_t interval = (0 != service_info.check_interval ? service_info.check_interval : m_service_table->check_interval);
+            m_check_scheduler.schedule(service_info.cmdl, now + m_check_scheduler.jitter(interval));
+            restart_service(service_info);
+            continue;
+        }
+
+        /* the probes of its last check are still running, that check is not done yet */
+        const bool probing = (m_probe_check_map.end() != m_probe_check_map.find(service_info.cmdl));
+        if (probing)
+        {
+            RUN_LOG_DBG("service {%s} is still probed by its last check", service_info.cmdl.c_str());
+        }
+
+        const uint64_t interval = (0 != service_info.check_interval ? service_info.check_interval : m_service_table->check_interval);
+        if (0 == iter->due_time)
+        {
+            m_check_scheduler.schedule(service_info.cmdl, now + m_check_scheduler.jitter(interval));
+        }
+        else
+        {
+            const uint64_t jitter = (UINT64_MAX == service_info.check_jitter ? interval / 10 : std::min(service_info.check_jitter, interval / 2));
+            m_check_scheduler.schedule(service_info.cmdl, next_check_time(service_info.cmdl, iter->due_time, interval, now) + m_check_scheduler.jitter(jitter));
+        }
+
+        if (!probing)
+        {
+            service_list.push_back(&service_info);
+        }
+    }
+
+    if (service_list.empty())
+    {
+        return;
+    }
+
+    /*
+     * the snapshot is only for a service without ports which the daemon
+     * does not track (not started by it), it is looked for by name then,
+     * the others are probed, or found by the identity of their process
+     */
+    bool snapshot_needed = false;
+    for (std::vector<const ServiceInfo *>::const_iterator iter = service_list.begin(); service_list.end() != iter && !snapshot_needed; ++iter)
+    {
+        snapshot_needed = ((*iter)->ports.empty() && m_process_info_map.end() == m_process_info_map.find((*iter)->cmdl));
+    }
+    if (snapshot_needed)
+    {
+        if (!m_process_snapshot.refresh())
+        {
+            RUN_LOG_ERR("refresh process snapshot failed");
+        }
+        RUN_LOG_DBG("check services with process snapshot %u", static_cast<size_t>(m_process_snapshot.generation()));
+    }
+
+    /*
+     * the probes are started here and run in the background (see ProbeEngine),
+     * a service is judged by check_probes() when the last of its probes is done,
+     * every port of every service is probed at the same time;
+     * a local service with <probe_listen> is looked up in the listen table instead,
+     * which is dumped once for the whole check
+     */
+    bool listen_table_refreshed = false;
+    bool listen_table_ok = false;
+    for (std::vector<const ServiceInfo *>::const_iterator iter_service = service_list.begin(); service_list.end() != iter_service; ++iter_service)
+    {
+        const ServiceInfo * service = *iter_service;
+
+        std::map<std::string, ProcessInfo>::const_iterator iter_proc = m_process_info_map.find(service->cmdl);
+        const bool stopping = (m_process_info_map.end() != iter_proc && m_process_stopper.is_stopping(iter_proc->second.identity.pid));
+
+        bool listen_probe = !stopping && service->probe_listen && !service->probe_http && !service->ports.empty() && m_listen_table.is_open() && ListenTable::is_local_host(service->host);
+        if (listen_probe && !listen_table_refreshed)
+        {
+            listen_table_refreshed = true;
+            listen_table_ok = m_listen_table.refresh();
+        }
+        listen_probe = listen_probe && listen_table_ok;
+
+        if (stopping || listen_probe)
+        {
+            /* a connection kept for the service is not looked at by this check */
+            for (std::vector<const Endpoint *>::const_iterator iter_endpoint = service->endpoints.begin(); service->endpoints.end() != iter_endpoint; ++iter_endpoint)
+            {
+                m_probe_engine.release((*iter_endpoint)->key);
+            }
+        }
+
+        if (stopping)
+        {
+            RUN_LOG_DBG("service {%s} is stopping", service->cmdl.c_str());
+            continue;
+        }
+
+        ResourceSample resource_sample;
+        if (m_resource_sampler.get_latest(service->cmdl, resource_sample) && !resource_sample.exited)
+        {
+            RUN_LOG_DBG("service {%s} cpu %u.%u%%, rss %uKB, threads %u, fds %u", service->cmdl.c_str(), resource_sample.cpu_usage / 10, resource_sample.cpu_usage % 10, static_cast<size_t>(resource_sample.rss / 1024), resource_sample.threads, resource_sample.fds);
+        }
+
+        if (service->ports.empty())
+        {
+            bool process_is_alive = false;
             if (m_process_info_map.end() != iter_proc)
             {
-                process_name = iter_proc->second.name;
+                process_is_alive = is_process_alive(iter_proc->second.identity);
             }
             else
             {
 #ifdef _MSC_VER
-                process_name = iter->file;
+                process_is_alive = is_process_alive(m_process_snapshot, service->file);
 #else
-                process_name = iter->cmdl;
+                process_is_alive = is_process_alive(m_process_snapshot, service->launch_spec.command_line());
 #endif // _MSC_VER
             }
-            if (!is_process_alive(process_name))
+            if (!process_is_alive)
             {
-                RUN_LOG_DBG("service {%s} is not alive", iter->cmdl.c_str());
-                service_is_ok = false;
+                RUN_LOG_DBG("service {%s} is not alive", service->cmdl.c_str());
+                restart_service(*service);
             }
         }
-        else
+        else if (listen_probe)
         {
-            for (std::list<std::string>::const_iterator iter_port = iter->ports.begin(); iter->ports.end() != iter_port; ++iter_port)
+            for (std::list<std::string>::const_iterator iter_port = service->ports.begin(); service->ports.end() != iter_port; ++iter_port)
             {
-                socket_t connecter = BAD_SOCKET;
-                if (!Stupid::Net::tcp_connect(iter->host.c_str(), iter_port->c_str(), connecter))
+                uint64_t inode = m_listen_table.find(service->host, *iter_port);
+                if (0 == inode)
+                {
+                    RUN_LOG_DBG("service {%s} is not listening on port %s", service->cmdl.c_str(), iter_port->c_str());
+                    restart_service(*service);
+                    break;
+                }
+                if (service->probe_owner && m_process_info_map.end() != iter_proc && !ListenTable::process_has_socket(iter_proc->second.identity.pid, inode))
                 {
-                    RUN_LOG_DBG("service {%s} can not be connected on port %s", iter->cmdl.c_str(), iter_port->c_str());
-                    service_is_ok = false;
+                    RUN_LOG_DBG("port %s is not listened by service {%s}", iter_port->c_str(), service->cmdl.c_str());
+                    restart_service(*service);
                     break;
                 }
-                Stupid::Net::tcp_close(connecter);
             }
         }
-
-        if (!service_is_ok)
+        else
         {
-            if (m_process_info_map.end() != iter_proc)
+            ProbeCheck & probe_check = m_probe_check_map[service->cmdl];
+            probe_check.ports.assign(service->ports.begin(), service->ports.end());
+            for (std::vector<const Endpoint *>::const_iterator iter_endpoint = service->endpoints.begin(); service->endpoints.end() != iter_endpoint; ++iter_endpoint)
             {
-                RUN_LOG_DBG("stop service {%s} begin", iter->cmdl.c_str());
-                kill_process(iter_proc->second.id, iter_proc->second.name);
-                m_process_info_map.erase(iter_proc);
-                RUN_LOG_DBG("stop service {%s} end", iter->cmdl.c_str());
-                append_record_content(m_record_file, "process {" + iter->cmdl + "} is stop");
+                const Endpoint & endpoint = **iter_endpoint;
+                if (service->probe_http && (service->probe_port.empty() || service->probe_port == endpoint.port))
+                {
+                    probe_check.probe_ids.push_back(m_probe_engine.add_http(endpoint, service->probe_timeout, service->probe_path, service->probe_status, service->probe_body));
+                }
+                else
+                {
+                    probe_check.probe_ids.push_back(m_probe_engine.add(endpoint, service->probe_timeout, service->probe_persistent));
+                }
             }
+        }
+    }
 
-            size_t process_id = 0;
-            std::string process_name;
-            if (create_process(iter->path, iter->cmdl, iter->show, process_id, process_name))
-            {
-                RUN_LOG_DBG("start service {%s} success", iter->cmdl.c_str());
-                ProcessInfo process_info = { process_id, process_name };
-                m_process_info_map[iter->cmdl] = process_info;
-                append_record_content(m_record_file, "process {" + iter->cmdl + "} is start");
-            }
-            else
+    /* a probe on a kept connection, or one which is refused at once, is done already */
+    check_probes();
+}
+
+void Daemon::check_probes()
+{
+    std::map<std::string, ProbeCheck>::iterator iter = m_probe_check_map.begin();
+    while (m_probe_check_map.end() != iter)
+    {
+        const ProbeCheck & probe_check = iter->second;
+
+        bool done = true;
+        for (std::vector<size_t>::const_iterator iter_probe = probe_check.probe_ids.begin(); probe_check.probe_ids.end() != iter_probe && done; ++iter_probe)
+        {
+            done = m_probe_engine.is_done(*iter_probe);
+        }
+        if (!done)
+        {
+            ++iter;
+            continue;
+        }
+
+        const std::string cmdl(iter->first);
+
+        bool service_is_ok = true;
+        for (size_t index = 0; index < probe_check.probe_ids.size(); ++index)
+        {
+            const size_t probe_id = probe_check.probe_ids[index];
+            if (service_is_ok && !m_probe_engine.is_ok(probe_id))
             {
-                RUN_LOG_ERR("start service {%s} failure", iter->cmdl.c_str());
-                append_record_content(m_record_file, "start process {" + iter->cmdl + "} failed");
+                if (0 != m_probe_engine.http_status(probe_id))
+                {
+                    RUN_LOG_DBG("service {%s} answers http status %d on port %s, errno(%d)", cmdl.c_str(), m_probe_engine.http_status(probe_id), probe_check.ports[index].c_str(), m_probe_engine.error(probe_id));
+                }
+                else
+                {
+                    RUN_LOG_DBG("service {%s} can not be connected on port %s, errno(%d)", cmdl.c_str(), probe_check.ports[index].c_str(), m_probe_engine.error(probe_id));
+                }
+                service_is_ok = false;
             }
+            m_probe_engine.remove(probe_id);
+        }
+
+        m_probe_check_map.erase(iter++);
+
+        if (service_is_ok)
+        {
+            continue;
+        }
+
+        /* the config may be reloaded, or the service stopped, while it was probed */
+        std::map<std::string, size_t>::const_iterator iter_index = m_service_table->index_map.find(cmdl);
+        if (m_service_table->index_map.end() == iter_index)
+        {
+            continue;
+        }
+
+        std::map<std::string, ProcessInfo>::const_iterator iter_proc = m_process_info_map.find(cmdl);
+        if (m_process_info_map.end() != iter_proc && m_process_stopper.is_stopping(iter_proc->second.identity.pid))
+        {
+            continue;
+        }
+
+        restart_service(m_service_table->services[iter_index->second]);
+    }
+}
+
+void Daemon::schedule_restart(const std::string & cmdl, uint64_t start_time)
+{
+    /*
+     * the service is started as the config is now, not as it was started
+     * before, and a service which is gone from the config is not supervised
+     * any more
+     */
+    if (m_service_table->index_map.end() == m_service_table->index_map.find(cmdl))
+    {
+        RUN_LOG_DBG("service {%s} is not in the config any more, not restarted", cmdl.c_str());
+        m_restart_delay_map.erase(cmdl);
+        return;
+    }
+
+    const uint64_t now = get_monotonic_nanoseconds();
+
+    uint64_t & delay = m_restart_delay_map[cmdl];
+    if (0 == delay || now - start_time >= s_stable_uptime)
+    {
+        delay = s_min_restart_delay;
+    }
+    else
+    {
+        delay = std::min(delay * 2, s_max_restart_delay);
+    }
+
+    /* a check of the process which is gone tells nothing about the next one */
+    std::map<std::string, ProbeCheck>::iterator iter_check = m_probe_check_map.find(cmdl);
+    if (m_probe_check_map.end() != iter_check)
+    {
+        for (std::vector<size_t>::const_iterator iter_probe = iter_check->second.probe_ids.begin(); iter_check->second.probe_ids.end() != iter_probe; ++iter_probe)
+        {
+            m_probe_engine.remove(*iter_probe);
+        }
+        m_probe_check_map.erase(iter_check);
+    }
+
+    /* the restart takes the place of its next check, see check_services */
+    m_restart_set.insert(cmdl);
+    m_check_scheduler.schedule(cmdl, now + delay);
+
+    RUN_LOG_DBG("service {%s} is started again in %ums", cmdl.c_str(), static_cast<size_t>(delay / 1000000));
+}
+
+void Daemon::restart_service(const ServiceInfo & service_info)
+{
+    /* it is started by its restart task, see schedule_restart */
+    if (m_restart_set.end() != m_restart_set.find(service_info.cmdl))
+    {
+        return;
+    }
+
+    std::map<std::string, ProcessInfo>::iterator iter_proc = m_process_info_map.find(service_info.cmdl);
+    if (m_process_info_map.end() != iter_proc)
+    {
+        RUN_LOG_DBG("stop service {%s} begin", service_info.cmdl.c_str());
+        if (m_process_stopper.stop(iter_proc->second.identity, iter_proc->second.in_cgroup ? iter_proc->second.cgroup : std::string(), service_info.stop_timeout * 1000))
+        {
+            /* restart when the whole tree is gone, see on_service_stopped */
+            return;
         }
+        m_process_watcher.unwatch(iter_proc->second.identity.pid);
+        m_process_info_map.erase(iter_proc);
+        RUN_LOG_DBG("stop service {%s} end", service_info.cmdl.c_str());
+        append_record_content(m_record_file, "process {" + service_info.cmdl + "} is stop");
     }
 
-    m_last_check_time = Stupid::Base::stupid_time();
+    ProcessInfo process_info;
+    process_info.launch_spec = service_info.launch_spec;
+    process_info.show = service_info.show;
+    process_info.cgroup = service_info.cgroup;
+    process_info.in_cgroup = false;
+    process_info.stop_timeout = service_info.stop_timeout;
+    process_info.limits = service_info.limits;
+    process_info.start_time = 0;
+    start_service(service_info.cmdl, process_info);
 }
@@ -0,0 +1,295 @@
+/********************************************************
+ * Description : endpoint resolver of daemon services
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#include "net/common/common.h"
+
+#ifndef _MSC_VER
+    #include <unistd.h>
+    #include <signal.h>
+    #include <sys/eventfd.h>
+#endif // _MSC_VER
+
+#include <cstring>
+#include <algorithm>
+
+#include "base/log/log.h"
+#include "endpoint_resolver.h"
+#include "utility.h"
+
+/* a name which can not be resolved is tried again this soon, or after the ttl if it is shorter */
+static const uint64_t s_retry_ms = 10000;
+
+#ifndef _MSC_VER
+
+/* runs on a thread of the resolver library, only the eventfd is touched here */
+static void notify_refresh_done(union sigval value)
+{
+    uint64_t count = 1;
+    ::write(value.sival_int, &count, sizeof(count));
+}
+
+#endif // _MSC_VER
+
+EndpointResolver::EndpointResolver()
+    : m_ttl_ms(0)
+    , m_next_expire_time(0)
+    , m_event_fd(-1)
+    , m_entry_list()
+    , m_entry_map()
+#ifndef _MSC_VER
+    , m_request_list()
+#endif // _MSC_VER
+{
+
+}
+
+EndpointResolver::~EndpointResolver()
+{
+    exit();
+}
+
+bool EndpointResolver::init(uint64_t ttl_ms)
+{
+    exit();
+
+    m_ttl_ms = (0 == ttl_ms ? 1000 : ttl_ms);
+    m_next_expire_time = UINT64_MAX;
+
+#ifndef _MSC_VER
+    m_event_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_event_fd < 0)
+    {
+        RUN_LOG_ERR("eventfd failed: %d", stupid_system_error());
+        return false;
+    }
+#endif // _MSC_VER
+
+    return true;
+}
+
+void EndpointResolver::exit()
+{
+#ifndef _MSC_VER
+    for (std::list<Request>::iterator iter = m_request_list.begin(); m_request_list.end() != iter; ++iter)
+    {
+        /* a lookup which is running can not be cancelled, its control block is used until it is done */
+        struct gaicb * control_list[1] = { &iter->control };
+        ::gai_cancel(&iter->control);
+        while (EAI_INPROGRESS == ::gai_error(&iter->control))
+        {
+            ::gai_suspend(control_list, 1, nullptr);
+        }
+        if (nullptr != iter->control.ar_result)
+        {
+            ::freeaddrinfo(iter->control.ar_result);
+        }
+    }
+    m_request_list.clear();
+
+    if (m_event_fd >= 0)
+    {
+        ::close(m_event_fd);
+        m_event_fd = -1;
+    }
+#endif // _MSC_VER
+
+    m_entry_map.clear();
+    m_entry_list.clear();
+}
+
+const Endpoint & EndpointResolver::get(const std::string & host, const std::string & port)
+{
+    const std::string key(host + ":" + port);
+
+    std::map<std::string, size_t>::const_iterator iter = m_entry_map.find(key);
+    if (m_entry_map.end() != iter)
+    {
+        return m_entry_list[iter->second].endpoint;
+    }
+
+    m_entry_list.push_back(Entry());
+    Entry & entry = m_entry_list.back();
+    entry.endpoint.host = host;
+    entry.endpoint.port = port;
+    entry.endpoint.key = key;
+    memset(&entry.endpoint.address, 0, sizeof(entry.endpoint.address));
+    entry.endpoint.address_size = 0;
+    entry.pending = false;
+    entry.numeric = resolve(entry.endpoint, true);
+
+    const uint64_t now_ms = get_monotonic_milliseconds();
+    if (entry.numeric)
+    {
+        entry.expire_time = UINT64_MAX;
+    }
+    else if (resolve(entry.endpoint, false))
+    {
+        entry.expire_time = now_ms + m_ttl_ms;
+    }
+    else
+    {
+        entry.expire_time = now_ms + std::min(m_ttl_ms, s_retry_ms);
+    }
+    m_next_expire_time = std::min(m_next_expire_time, entry.expire_time);
+
+    m_entry_map[key] = m_entry_list.size() - 1;
+
+    return entry.endpoint;
+}
+
+void EndpointResolver::update(uint64_t now_ms)
+{
+#ifndef _MSC_VER
+    /* a notice may come after its request is collected already, it is read anyway */
+    uint64_t count = 0;
+    ::read(m_event_fd, &count, sizeof(count));
+
+    if (!m_request_list.empty())
+    {
+        collect(now_ms);
+    }
+
+    if (now_ms < m_next_expire_time)
+    {
+        return;
+    }
+
+    m_next_expire_time = UINT64_MAX;
+    for (size_t index = 0; index < m_entry_list.size(); ++index)
+    {
+        Entry & entry = m_entry_list[index];
+        if (entry.numeric || entry.pending)
+        {
+            continue;
+        }
+        if (entry.expire_time <= now_ms)
+        {
+            refresh(entry, index, now_ms);
+        }
+        if (!entry.pending)
+        {
+            m_next_expire_time = std::min(m_next_expire_time, entry.expire_time);
+        }
+    }
+#endif // _MSC_VER
+}
+
+uint64_t EndpointResolver::next_expire_time() const
+{
+    return m_next_expire_time;
+}
+
+int EndpointResolver::event_fd() const
+{
+    return m_event_fd;
+}
+
+bool EndpointResolver::resolve(Endpoint & endpoint, bool numeric)
+{
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = (numeric ? AI_NUMERICHOST | AI_NUMERICSERV : 0);
+
+    struct addrinfo * address = nullptr;
+    int ret = ::getaddrinfo(endpoint.host.c_str(), endpoint.port.c_str(), &hints, &address);
+    if (0 != ret || nullptr == address)
+    {
+        if (!numeric)
+        {
+            RUN_LOG_ERR("getaddrinfo(%s, %s) failed: %s", endpoint.host.c_str(), endpoint.port.c_str(), gai_strerror(ret));
+        }
+        return false;
+    }
+
+    memcpy(&endpoint.address, address->ai_addr, address->ai_addrlen);
+    endpoint.address_size = static_cast<uint32_t>(address->ai_addrlen);
+    ::freeaddrinfo(address);
+
+    return true;
+}
+
+void EndpointResolver::collect(uint64_t now_ms)
+{
+#ifndef _MSC_VER
+    for (std::list<Request>::iterator iter = m_request_list.begin(); m_request_list.end() != iter;)
+    {
+        int ret = ::gai_error(&iter->control);
+        if (EAI_INPROGRESS == ret)
+        {
+            ++iter;
+            continue;
+        }
+
+        Entry & entry = m_entry_list[iter->index];
+        entry.pending = false;
+
+        struct addrinfo * address = iter->control.ar_result;
+        if (0 == ret && nullptr != address)
+        {
+            if (entry.endpoint.address_size != address->ai_addrlen || 0 != memcmp(&entry.endpoint.address, address->ai_addr, address->ai_addrlen))
+            {
+                RUN_LOG_DBG("endpoint %s is resolved to a new address", entry.endpoint.key.c_str());
+                memcpy(&entry.endpoint.address, address->ai_addr, address->ai_addrlen);
+                entry.endpoint.address_size = static_cast<uint32_t>(address->ai_addrlen);
+            }
+            entry.expire_time = now_ms + m_ttl_ms;
+        }
+        else
+        {
+            RUN_LOG_ERR("refresh endpoint %s failed: %s", entry.endpoint.key.c_str(), gai_strerror(ret));
+            entry.expire_time = now_ms + std::min(m_ttl_ms, s_retry_ms);
+        }
+        m_next_expire_time = std::min(m_next_expire_time, entry.expire_time);
+
+        if (nullptr != address)
+        {
+            ::freeaddrinfo(address);
+        }
+        m_request_list.erase(iter++);
+    }
+#endif // _MSC_VER
+}
+
+void EndpointResolver::refresh(Entry & entry, size_t index, uint64_t now_ms)
+{
+#ifndef _MSC_VER
+    m_request_list.push_back(Request());
+    Request & request = m_request_list.back();
+    request.index = index;
+    memset(&request.hints, 0, sizeof(request.hints));
+    request.hints.ai_family = AF_UNSPEC;
+    request.hints.ai_socktype = SOCK_STREAM;
+    memset(&request.control, 0, sizeof(request.control));
+    request.control.ar_name = entry.endpoint.host.c_str();
+    request.control.ar_service = entry.endpoint.port.c_str();
+    request.control.ar_request = &request.hints;
+
+    struct sigevent notify;
+    memset(&notify, 0, sizeof(notify));
+    notify.sigev_notify = SIGEV_THREAD;
+    notify.sigev_notify_function = notify_refresh_done;
+    notify.sigev_value.sival_int = m_event_fd;
+
+    struct gaicb * control_list[1] = { &request.control };
+    int ret = ::getaddrinfo_a(GAI_NOWAIT, control_list, 1, &notify);
+    if (0 != ret)
+    {
+        RUN_LOG_ERR("getaddrinfo_a(%s) failed: %s", entry.endpoint.key.c_str(), gai_strerror(ret));
+        m_request_list.pop_back();
+        entry.expire_time = now_ms + std::min(m_ttl_ms, s_retry_ms);
+        return;
+    }
+
+    entry.pending = true;
+#endif // _MSC_VER
+}
@@ -0,0 +1,230 @@
+/********************************************************
+ * Description : event loop of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#include "net/common/common.h"
+
+#ifndef _MSC_VER
+    #include <errno.h>
+    #include <unistd.h>
+    #include <sys/epoll.h>
+    #include <sys/timerfd.h>
+    #include <sys/eventfd.h>
+#endif // _MSC_VER
+
+#include <cstring>
+
+#include "base/log/log.h"
+#include "event_loop.h"
+
+EventLoop::EventLoop()
+    : m_epoll_fd(-1)
+    , m_timer_fd(-1)
+    , m_wake_fd(-1)
+    , m_armed_deadline(UINT64_MAX)
+{
+
+}
+
+EventLoop::~EventLoop()
+{
+    exit();
+}
+
+bool EventLoop::init()
+{
+    exit();
+
+#ifdef _MSC_VER
+    return false;
+#else
+    m_epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll_fd < 0)
+    {
+        RUN_LOG_ERR("epoll_create1 failed: %d", stupid_system_error());
+        return false;
+    }
+
+    m_timer_fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_timer_fd < 0)
+    {
+        RUN_LOG_ERR("timerfd_create failed: %d", stupid_system_error());
+        exit();
+        return false;
+    }
+
+    m_wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wake_fd < 0)
+    {
+        RUN_LOG_ERR("eventfd failed: %d", stupid_system_error());
+        exit();
+        return false;
+    }
+
+    if (!add(m_timer_fd) || !add(m_wake_fd))
+    {
+        exit();
+        return false;
+    }
+
+    m_armed_deadline = UINT64_MAX;
+
+    return true;
+#endif // _MSC_VER
+}
+
+void EventLoop::exit()
+{
+#ifndef _MSC_VER
+    if (m_wake_fd >= 0)
+    {
+        ::close(m_wake_fd);
+        m_wake_fd = -1;
+    }
+
+    if (m_timer_fd >= 0)
+    {
+        ::close(m_timer_fd);
+        m_timer_fd = -1;
+    }
+
+    if (m_epoll_fd >= 0)
+    {
+        ::close(m_epoll_fd);
+        m_epoll_fd = -1;
+    }
+#endif // _MSC_VER
+}
+
+bool EventLoop::add(int fd)
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    if (m_epoll_fd < 0 || fd < 0)
+    {
+        return false;
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        RUN_LOG_ERR("epoll_ctl(add %d) failed: %d", fd, stupid_system_error());
+        return false;
+    }
+
+    return true;
+#endif // _MSC_VER
+}
+
+void EventLoop::remove(int fd)
+{
+#ifndef _MSC_VER
+    if (m_epoll_fd >= 0 && fd >= 0)
+    {
+        ::epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+#endif // _MSC_VER
+}
+
+bool EventLoop::wait(uint64_t deadline_ns)
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    if (m_epoll_fd < 0)
+    {
+        return false;
+    }
+
+    if (!arm(deadline_ns))
+    {
+        return false;
+    }
+
+    struct epoll_event events[16];
+    int count = ::epoll_wait(m_epoll_fd, events, sizeof(events) / sizeof(events[0]), -1);
+    if (count < 0)
+    {
+        if (EINTR == errno)
+        {
+            return true;
+        }
+        RUN_LOG_ERR("epoll_wait failed: %d", stupid_system_error());
+        return false;
+    }
+
+    for (int index = 0; index < count; ++index)
+    {
+        uint64_t value = 0;
+        if (m_timer_fd == events[index].data.fd)
+        {
+            /* a one-shot timer, it is armed again by the next wait() */
+            ::read(m_timer_fd, &value, sizeof(value));
+            m_armed_deadline = UINT64_MAX;
+        }
+        else if (m_wake_fd == events[index].data.fd)
+        {
+            ::read(m_wake_fd, &value, sizeof(value));
+        }
+    }
+
+    return true;
+#endif // _MSC_VER
+}
+
+void EventLoop::wake()
+{
+#ifndef _MSC_VER
+    if (m_wake_fd >= 0)
+    {
+        uint64_t value = 1;
+        ::write(m_wake_fd, &value, sizeof(value));
+    }
+#endif // _MSC_VER
+}
+
+bool EventLoop::arm(uint64_t deadline_ns)
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    if (deadline_ns == m_armed_deadline)
+    {
+        return true;
+    }
+
+    /* an absolute time which is passed already expires at once, a zero time disarms */
+    struct itimerspec timer;
+    memset(&timer, 0, sizeof(timer));
+    if (UINT64_MAX != deadline_ns)
+    {
+        timer.it_value.tv_sec = static_cast<time_t>(deadline_ns / 1000000000);
+        timer.it_value.tv_nsec = static_cast<long>(deadline_ns % 1000000000);
+        if (0 == timer.it_value.tv_sec && 0 == timer.it_value.tv_nsec)
+        {
+            timer.it_value.tv_nsec = 1;
+        }
+    }
+
+    if (::timerfd_settime(m_timer_fd, TFD_TIMER_ABSTIME, &timer, nullptr) < 0)
+    {
+        RUN_LOG_ERR("timerfd_settime failed: %d", stupid_system_error());
+        return false;
+    }
+
+    m_armed_deadline = deadline_ns;
+
+    return true;
+#endif // _MSC_VER
+}
@@ -0,0 +1,334 @@
+/********************************************************
+ * Description : listen socket table of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#include "net/common/common.h"
+
+#ifndef _MSC_VER
+    #include <errno.h>
+    #include <netdb.h>
+    #include <dirent.h>
+    #include <unistd.h>
+    #include <arpa/inet.h>
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <linux/netlink.h>
+    #include <linux/sock_diag.h>
+    #include <linux/inet_diag.h>
+#endif // _MSC_VER
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+
+#include "base/log/log.h"
+#include "listen_table.h"
+
+#ifndef _MSC_VER
+
+static bool parse_host(const std::string & host, int & family, uint8_t address[16])
+{
+    memset(address, 0, 16);
+    const char * text = ("localhost" == host ? "127.0.0.1" : host.c_str());
+    if (1 == ::inet_pton(AF_INET, text, address))
+    {
+        family = AF_INET;
+        return true;
+    }
+    if (1 == ::inet_pton(AF_INET6, text, address))
+    {
+        family = AF_INET6;
+        return true;
+    }
+    return false;
+}
+
+static uint16_t parse_port(const std::string & port)
+{
+    char * end = nullptr;
+    unsigned long number = strtoul(port.c_str(), &end, 10);
+    if (end != port.c_str() && '\0' == *end && number > 0 && number <= 65535)
+    {
+        return static_cast<uint16_t>(number);
+    }
+
+    struct servent * service = ::getservbyname(port.c_str(), "tcp");
+    return (nullptr == service ? 0 : ntohs(static_cast<uint16_t>(service->s_port)));
+}
+
+#endif // _MSC_VER
+
+ListenTable::ListenTable()
+    : m_socket(-1)
+    , m_sequence(0)
+    , m_buffer()
+    , m_entry_list()
+{
+
+}
+
+ListenTable::~ListenTable()
+{
+    exit();
+}
+
+bool ListenTable::init()
+{
+    exit();
+
+#ifdef _MSC_VER
+    return false;
+#else
+    m_socket = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (m_socket < 0)
+    {
+        RUN_LOG_ERR("socket(NETLINK_SOCK_DIAG) failed: %d", stupid_system_error());
+        return false;
+    }
+
+    m_buffer.resize(64 * 1024);
+
+    return true;
+#endif // _MSC_VER
+}
+
+void ListenTable::exit()
+{
+#ifndef _MSC_VER
+    if (m_socket >= 0)
+    {
+        ::close(m_socket);
+        m_socket = -1;
+    }
+#endif // _MSC_VER
+
+    m_entry_list.clear();
+}
+
+bool ListenTable::is_open() const
+{
+    return m_socket >= 0;
+}
+
+bool ListenTable::refresh()
+{
+    m_entry_list.clear();
+
+#ifdef _MSC_VER
+    return false;
+#else
+    if (m_socket < 0)
+    {
+        return false;
+    }
+
+    if (!dump(AF_INET) || !dump(AF_INET6))
+    {
+        m_entry_list.clear();
+        return false;
+    }
+
+    std::sort(m_entry_list.begin(), m_entry_list.end(), entry_port_less);
+
+    return true;
+#endif // _MSC_VER
+}
+
+uint64_t ListenTable::find(const std::string & host, const std::string & port) const
+{
+#ifdef _MSC_VER
+    return 0;
+#else
+    int family = AF_UNSPEC;
+    uint8_t address[16];
+    Entry key;
+    key.port = parse_port(port);
+    if (0 == key.port || !parse_host(host, family, address))
+    {
+        return 0;
+    }
+
+    static const uint8_t any_address[16] = { 0 };
+    static const uint8_t mapped_prefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+
+    std::vector<Entry>::const_iterator iter = std::lower_bound(m_entry_list.begin(), m_entry_list.end(), key, entry_port_less);
+    for (; m_entry_list.end() != iter && key.port == iter->port; ++iter)
+    {
+        if (AF_INET == iter->family)
+        {
+            /* 0.0.0.0 takes every ipv4 address */
+            if (AF_INET == family && (0 == memcmp(iter->address, any_address, 4) || 0 == memcmp(iter->address, address, 4)))
+            {
+                return iter->inode;
+            }
+        }
+        else
+        {
+            /* :: takes every address (unless IPV6_V6ONLY), ::ffff:a.b.c.d is an ipv4 address */
+            if (0 == memcmp(iter->address, any_address, 16))
+            {
+                return iter->inode;
+            }
+            if (AF_INET6 == family && 0 == memcmp(iter->address, address, 16))
+            {
+                return iter->inode;
+            }
+            if (AF_INET == family && 0 == memcmp(iter->address, mapped_prefix, 12) && 0 == memcmp(iter->address + 12, address, 4))
+            {
+                return iter->inode;
+            }
+        }
+    }
+
+    return 0;
+#endif // _MSC_VER
+}
+
+bool ListenTable::is_local_host(const std::string & host)
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    int family = AF_UNSPEC;
+    uint8_t address[16];
+    if (!parse_host(host, family, address))
+    {
+        return false;
+    }
+
+    static const uint8_t loopback6[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+    static const uint8_t any_address[16] = { 0 };
+
+    if (AF_INET == family)
+    {
+        return 127 == address[0] || 0 == memcmp(address, any_address, 4);
+    }
+    return 0 == memcmp(address, loopback6, 16) || 0 == memcmp(address, any_address, 16);
+#endif // _MSC_VER
+}
+
+bool ListenTable::process_has_socket(size_t process_id, uint64_t inode)
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    std::ostringstream oss;
+    oss << "/proc/" << process_id << "/fd";
+
+    DIR * directory = ::opendir(oss.str().c_str());
+    if (nullptr == directory)
+    {
+        return false;
+    }
+
+    char target[64] = { 0 };
+    snprintf(target, sizeof(target), "socket:[%llu]", static_cast<unsigned long long>(inode));
+    const size_t target_size = strlen(target);
+
+    bool found = false;
+    struct dirent * entry = nullptr;
+    while (!found && nullptr != (entry = ::readdir(directory)))
+    {
+        if ('.' == entry->d_name[0])
+        {
+            continue;
+        }
+
+        char link[64] = { 0 };
+        ssize_t size = ::readlinkat(::dirfd(directory), entry->d_name, link, sizeof(link) - 1);
+        found = (static_cast<ssize_t>(target_size) == size && 0 == memcmp(link, target, target_size));
+    }
+
+    ::closedir(directory);
+
+    return found;
+#endif // _MSC_VER
+}
+
+bool ListenTable::entry_port_less(const Entry & lhs, const Entry & rhs)
+{
+    return lhs.port < rhs.port;
+}
+
+bool ListenTable::dump(int family)
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    struct
+    {
+        struct nlmsghdr             header;
+        struct inet_diag_req_v2     request;
+    } message;
+    memset(&message, 0x00, sizeof(message));
+
+    message.header.nlmsg_len = sizeof(message);
+    message.header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    message.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    message.header.nlmsg_seq = ++m_sequence;
+    message.request.sdiag_family = static_cast<__u8>(family);
+    message.request.sdiag_protocol = IPPROTO_TCP;
+    message.request.idiag_states = (1U << TCP_LISTEN);
+
+    if (::send(m_socket, &message, sizeof(message), 0) < 0)
+    {
+        RUN_LOG_ERR("send(SOCK_DIAG_BY_FAMILY) failed: %d", stupid_system_error());
+        return false;
+    }
+
+    while (true)
+    {
+        ssize_t size = ::recv(m_socket, &m_buffer[0], m_buffer.size(), 0);
+        if (size < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            RUN_LOG_ERR("recv(NETLINK_SOCK_DIAG) failed: %d", stupid_system_error());
+            return false;
+        }
+
+        int length = static_cast<int>(size);
+        for (const struct nlmsghdr * header = reinterpret_cast<const struct nlmsghdr *>(&m_buffer[0]); NLMSG_OK(header, length); header = NLMSG_NEXT(header, length))
+        {
+            if (m_sequence != header->nlmsg_seq)
+            {
+                continue;
+            }
+
+            if (NLMSG_DONE == header->nlmsg_type)
+            {
+                return true;
+            }
+
+            if (NLMSG_ERROR == header->nlmsg_type)
+            {
+                const struct nlmsgerr * error = reinterpret_cast<const struct nlmsgerr *>(NLMSG_DATA(header));
+                RUN_LOG_ERR("dump listen sockets (family %d) failed: %d", family, -error->error);
+                return false;
+            }
+
+            const struct inet_diag_msg * diag = reinterpret_cast<const struct inet_diag_msg *>(NLMSG_DATA(header));
+
+            Entry entry;
+            entry.port = ntohs(diag->id.idiag_sport);
+            entry.family = diag->idiag_family;
+            memset(entry.address, 0, sizeof(entry.address));
+            memcpy(entry.address, diag->id.idiag_src, (AF_INET == diag->idiag_family ? 4 : 16));
+            entry.inode = diag->idiag_inode;
+            m_entry_list.push_back(entry);
+        }
+    }
+#endif // _MSC_VER
+}
@@ -9,6 +9,10 @@
  * Copyright(C): 2015 - 2017
  ********************************************************/
 
+#ifndef _MSC_VER
+    #include <signal.h>
+#endif // _MSC_VER
+
 #include <string>
 #include <iostream>
 #include "net/utility/net_switch.h"
@@ -43,6 +47,17 @@ static bool get_root_directory(const char * file, std::string & path)
 
 int main(int argc, char * argv[])
 {
+#ifndef _MSC_VER
+    /*
+     * block SIGCHLD before any thread is created, so every thread inherits
+     * the mask and child exits are only delivered to the reaper's signalfd
+     */
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    ::sigprocmask(SIG_BLOCK, &mask, nullptr);
+#endif // _MSC_VER
+
     size_t unique_id = 0;
     if (!exclusive_init("daemon", unique_id))
     {
@@ -0,0 +1,915 @@
+/********************************************************
+ * Description : probe engine of daemon services
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#include "net/common/common.h"
+
+#ifndef _MSC_VER
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/types.h>
+    #include <sys/epoll.h>
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+#endif // _MSC_VER
+
+#include <cerrno>
+#include <cctype>
+#include <cstdio>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "net/utility/tcp.h"
+#include "base/log/log.h"
+#include "probe_engine.h"
+#include "utility.h"
+
+#ifndef _MSC_VER
+
+/* a health check answers with a few bytes, a larger response fails the probe */
+static const size_t s_max_response_size = 64 * 1024;
+
+enum HttpParseResult
+{
+    http_incomplete,
+    http_complete,
+    http_bad
+};
+
+/* the headers are in lower case, the value is trimmed */
+static bool find_http_header(const std::string & headers, const char * name, std::string & value)
+{
+    const std::string key = std::string("\r\n") + name + ":";
+    std::string::size_type begin = headers.find(key);
+    if (std::string::npos == begin)
+    {
+        return false;
+    }
+    begin += key.size();
+
+    std::string::size_type end = headers.find("\r\n", begin);
+    value = headers.substr(begin, std::string::npos == end ? std::string::npos : end - begin);
+
+    const char * blanks = " \t";
+    std::string::size_type head = value.find_first_not_of(blanks);
+    value = (std::string::npos == head ? std::string() : value.substr(head, value.find_last_not_of(blanks) - head + 1));
+
+    return true;
+}
+
+/*
+ * the body is framed by Content-Length, by chunks, or by the end of the connection,
+ * consumed is the size of the whole response when it is complete
+ */
+static HttpParseResult parse_http_response(const std::string & response, bool eof, int & status, bool & keep_alive, std::string & body, size_t & consumed)
+{
+    std::string::size_type header_end = response.find("\r\n\r\n");
+    if (std::string::npos == header_end)
+    {
+        return http_incomplete;
+    }
+
+    int major = 0;
+    int minor = 0;
+    if (3 != sscanf(response.c_str(), "HTTP/%d.%d %d", &major, &minor, &status))
+    {
+        return http_bad;
+    }
+
+    std::string headers(response, 0, header_end + 2);
+    std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+
+    std::string value;
+    keep_alive = (major > 1 || (1 == major && minor >= 1));
+    if (find_http_header(headers, "connection", value))
+    {
+        if (std::string::npos != value.find("close"))
+        {
+            keep_alive = false;
+        }
+        else if (std::string::npos != value.find("keep-alive"))
+        {
+            keep_alive = true;
+        }
+    }
+
+    body.clear();
+
+    const size_t body_begin = header_end + 4;
+
+    if (1 == status / 100 || 204 == status || 304 == status)
+    {
+        consumed = body_begin;
+        return http_complete;
+    }
+
+    if (find_http_header(headers, "transfer-encoding", value) && std::string::npos != value.find("chunked"))
+    {
+        size_t position = body_begin;
+        while (true)
+        {
+            std::string::size_type line_end = response.find("\r\n", position);
+            if (std::string::npos == line_end)
+            {
+                return http_incomplete;
+            }
+
+            char * end = nullptr;
+            size_t chunk_size = static_cast<size_t>(strtoul(response.c_str() + position, &end, 16));
+            if (end == response.c_str() + position)
+            {
+                return http_bad;
+            }
+            position = line_end + 2;
+
+            if (0 == chunk_size)
+            {
+                /* no trailer is expected, the last chunk is followed by an empty line */
+                if (response.size() < position + 2)
+                {
+                    return http_incomplete;
+                }
+                consumed = position + 2;
+                return http_complete;
+            }
+
+            if (response.size() < position + chunk_size + 2)
+            {
+                return http_incomplete;
+            }
+            body.append(response, position, chunk_size);
+            position += chunk_size + 2;
+        }
+    }
+
+    if (find_http_header(headers, "content-length", value))
+    {
+        size_t content_length = static_cast<size_t>(strtoul(value.c_str(), nullptr, 10));
+        if (response.size() < body_begin + content_length)
+        {
+            return http_incomplete;
+        }
+        body.assign(response, body_begin, content_length);
+        consumed = body_begin + content_length;
+        return http_complete;
+    }
+
+    if (!eof)
+    {
+        return http_incomplete;
+    }
+    keep_alive = false;
+    body.assign(response, body_begin, std::string::npos);
+    consumed = response.size();
+    return http_complete;
+}
+
+#endif // _MSC_VER
+
+ProbeEngine::ProbeEngine()
+    : m_epoll_fd(-1)
+    , m_watch_fd(-1)
+    , m_connection_map()
+    , m_idle_map()
+    , m_max_inflight(0)
+    , m_inflight(0)
+    , m_last_probe_id(0)
+    , m_probe_map()
+    , m_probe_queue()
+    , m_deadline_set()
+{
+
+}
+
+ProbeEngine::~ProbeEngine()
+{
+    exit();
+}
+
+bool ProbeEngine::init(size_t max_inflight)
+{
+    exit();
+
+    m_max_inflight = (0 == max_inflight ? 1 : max_inflight);
+
+#ifndef _MSC_VER
+    m_epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll_fd < 0)
+    {
+        RUN_LOG_ERR("epoll_create1 failed: %d", stupid_system_error());
+        return false;
+    }
+
+    m_watch_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (m_watch_fd < 0)
+    {
+        RUN_LOG_ERR("epoll_create1 failed: %d", stupid_system_error());
+        ::close(m_epoll_fd);
+        m_epoll_fd = -1;
+        return false;
+    }
+#endif // _MSC_VER
+
+    return true;
+}
+
+void ProbeEngine::exit()
+{
+    for (std::map<size_t, Probe>::iterator iter = m_probe_map.begin(); m_probe_map.end() != iter; ++iter)
+    {
+        if (is_active(iter->second))
+        {
+            finish(iter->second, ECANCELED);
+        }
+    }
+    m_probe_map.clear();
+    m_probe_queue.clear();
+    m_deadline_set.clear();
+    m_inflight = 0;
+
+#ifndef _MSC_VER
+    for (std::map<std::string, Connection>::iterator iter = m_connection_map.begin(); m_connection_map.end() != iter; ++iter)
+    {
+        close_socket(iter->second.fd);
+    }
+    m_connection_map.clear();
+
+    for (std::map<std::string, Connection>::iterator iter = m_idle_map.begin(); m_idle_map.end() != iter; ++iter)
+    {
+        close_socket(iter->second.fd);
+    }
+    m_idle_map.clear();
+
+    if (m_watch_fd >= 0)
+    {
+        ::close(m_watch_fd);
+        m_watch_fd = -1;
+    }
+
+    if (m_epoll_fd >= 0)
+    {
+        ::close(m_epoll_fd);
+        m_epoll_fd = -1;
+    }
+#endif // _MSC_VER
+}
+
+size_t ProbeEngine::add(const Endpoint & endpoint, uint64_t timeout_ms, bool persistent)
+{
+    Probe probe;
+    init_probe(probe, endpoint, timeout_ms, persistent);
+    return submit(probe);
+}
+
+size_t ProbeEngine::add_http(const Endpoint & endpoint, uint64_t timeout_ms, const std::string & path, int expect_status, const std::string & expect_body)
+{
+    Probe probe;
+    init_probe(probe, endpoint, timeout_ms, false);
+    probe.http = true;
+    probe.expect_status = expect_status;
+    probe.expect_body = expect_body;
+
+    const std::string & host = endpoint.host;
+    const std::string host_name(std::string::npos == host.find(':') ? host : "[" + host + "]");
+    probe.request = "GET " + (path.empty() ? std::string("/") : path) + " HTTP/1.1\r\n"
+                    "Host: " + host_name + ":" + endpoint.port + "\r\n"
+                    "User-Agent: daemon\r\n"
+                    "Accept: */*\r\n"
+                    "Connection: keep-alive\r\n"
+                    "\r\n";
+
+    return submit(probe);
+}
+
+void ProbeEngine::remove(size_t probe_id)
+{
+    std::map<size_t, Probe>::iterator iter = m_probe_map.find(probe_id);
+    if (m_probe_map.end() == iter)
+    {
+        return;
+    }
+
+    if (is_active(iter->second))
+    {
+        finish(iter->second, ECANCELED);
+    }
+
+    /* an id in the queue is skipped when it comes to the front */
+    m_probe_map.erase(iter);
+}
+
+void ProbeEngine::retain(const std::set<std::string> & key_set)
+{
+#ifndef _MSC_VER
+    for (std::map<std::string, Connection>::iterator iter = m_connection_map.begin(); m_connection_map.end() != iter;)
+    {
+        if (key_set.end() != key_set.find(iter->first))
+        {
+            ++iter;
+            continue;
+        }
+        close_socket(iter->second.fd);
+        m_connection_map.erase(iter++);
+    }
+
+    for (std::map<std::string, Connection>::iterator iter = m_idle_map.begin(); m_idle_map.end() != iter;)
+    {
+        if (key_set.end() != key_set.find(iter->first))
+        {
+            ++iter;
+            continue;
+        }
+        close_socket(iter->second.fd);
+        m_idle_map.erase(iter++);
+    }
+#endif // _MSC_VER
+}
+
+void ProbeEngine::release(const std::string & key)
+{
+#ifndef _MSC_VER
+    std::map<std::string, Connection>::iterator iter = m_connection_map.find(key);
+    if (m_connection_map.end() != iter)
+    {
+        close_socket(iter->second.fd);
+        m_connection_map.erase(iter);
+    }
+
+    iter = m_idle_map.find(key);
+    if (m_idle_map.end() != iter)
+    {
+        close_socket(iter->second.fd);
+        m_idle_map.erase(iter);
+    }
+#endif // _MSC_VER
+}
+
+void ProbeEngine::update(std::vector<std::string> & dropped_list)
+{
+    dropped_list.clear();
+
+#ifndef _MSC_VER
+    if (m_epoll_fd >= 0 && 0 != m_inflight)
+    {
+        /* level-triggered, the events which are left for now wake the event loop again */
+        struct epoll_event events[64];
+        int count = ::epoll_wait(m_epoll_fd, events, sizeof(events) / sizeof(events[0]), 0);
+        if (count < 0 && EINTR != errno)
+        {
+            RUN_LOG_ERR("epoll_wait failed: %d", stupid_system_error());
+        }
+
+        for (int index = 0; index < count; ++index)
+        {
+            size_t probe_id = static_cast<size_t>(events[index].data.u64);
+            std::map<size_t, Probe>::iterator iter = m_probe_map.find(probe_id);
+            if (m_probe_map.end() != iter && is_active(iter->second))
+            {
+                advance(iter->second, probe_id, events[index].events);
+            }
+        }
+    }
+
+    const uint64_t now_ms = get_monotonic_milliseconds();
+
+    while (!m_deadline_set.empty() && m_deadline_set.begin()->first <= now_ms)
+    {
+        std::map<size_t, Probe>::iterator iter = m_probe_map.find(m_deadline_set.begin()->second);
+        if (m_probe_map.end() == iter || !is_active(iter->second))
+        {
+            m_deadline_set.erase(m_deadline_set.begin());
+            continue;
+        }
+        finish(iter->second, ETIMEDOUT);
+    }
+
+    start_queued(now_ms);
+
+    if (m_watch_fd < 0 || m_connection_map.empty())
+    {
+        return;
+    }
+
+    struct epoll_event events[32];
+    int count = ::epoll_wait(m_watch_fd, events, sizeof(events) / sizeof(events[0]), 0);
+    for (int index = 0; index < count; ++index)
+    {
+        for (std::map<std::string, Connection>::iterator iter = m_connection_map.begin(); m_connection_map.end() != iter; ++iter)
+        {
+            if (iter->second.fd == events[index].data.fd)
+            {
+                dropped_list.push_back(iter->first);
+                close_socket(iter->second.fd);
+                m_connection_map.erase(iter);
+                break;
+            }
+        }
+    }
+#endif // _MSC_VER
+}
+
+uint64_t ProbeEngine::next_deadline() const
+{
+    return (m_deadline_set.empty() ? UINT64_MAX : m_deadline_set.begin()->first);
+}
+
+int ProbeEngine::probe_fd() const
+{
+    return m_epoll_fd;
+}
+
+int ProbeEngine::event_fd() const
+{
+    return m_watch_fd;
+}
+
+bool ProbeEngine::is_done(size_t probe_id) const
+{
+    std::map<size_t, Probe>::const_iterator iter = m_probe_map.find(probe_id);
+    return m_probe_map.end() != iter && (probe_ok == iter->second.state || probe_failed == iter->second.state);
+}
+
+bool ProbeEngine::is_ok(size_t probe_id) const
+{
+    std::map<size_t, Probe>::const_iterator iter = m_probe_map.find(probe_id);
+    return m_probe_map.end() != iter && probe_ok == iter->second.state;
+}
+
+int ProbeEngine::error(size_t probe_id) const
+{
+    std::map<size_t, Probe>::const_iterator iter = m_probe_map.find(probe_id);
+    return (m_probe_map.end() != iter ? iter->second.error : 0);
+}
+
+int ProbeEngine::http_status(size_t probe_id) const
+{
+    std::map<size_t, Probe>::const_iterator iter = m_probe_map.find(probe_id);
+    return (m_probe_map.end() != iter ? iter->second.status : 0);
+}
+
+void ProbeEngine::close_socket(int fd)
+{
+#ifndef _MSC_VER
+    struct linger linger;
+    linger.l_onoff = 1;
+    linger.l_linger = 0;
+    ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+    ::close(fd);
+#endif // _MSC_VER
+}
+
+bool ProbeEngine::is_active(const Probe & probe)
+{
+    return probe_connecting == probe.state || probe_sending == probe.state || probe_receiving == probe.state;
+}
+
+void ProbeEngine::init_probe(Probe & probe, const Endpoint & endpoint, uint64_t timeout_ms, bool persistent)
+{
+    probe.id = 0;
+    probe.endpoint = &endpoint;
+    probe.timeout_ms = timeout_ms;
+    probe.deadline = 0;
+    probe.fd = -1;
+    probe.persistent = persistent;
+    probe.state = probe_queued;
+    probe.error = 0;
+    probe.http = false;
+    probe.reused = false;
+    probe.sent = 0;
+    probe.expect_status = 0;
+    probe.status = 0;
+    probe.keep_alive = false;
+}
+
+size_t ProbeEngine::submit(const Probe & probe)
+{
+    const size_t probe_id = ++m_last_probe_id;
+
+    Probe & new_probe = m_probe_map.insert(std::make_pair(probe_id, probe)).first->second;
+    new_probe.id = probe_id;
+
+#ifdef _MSC_VER
+    socket_t connecter = BAD_SOCKET;
+    if (Stupid::Net::tcp_connect(new_probe.endpoint->host.c_str(), new_probe.endpoint->port.c_str(), connecter))
+    {
+        Stupid::Net::tcp_close(connecter);
+        new_probe.state = probe_ok;
+    }
+    else
+    {
+        new_probe.state = probe_failed;
+        new_probe.error = stupid_system_error();
+    }
+#else
+    if (m_epoll_fd < 0)
+    {
+        new_probe.state = probe_failed;
+        new_probe.error = EBADF;
+        return probe_id;
+    }
+
+    m_probe_queue.push_back(probe_id);
+    start_queued(get_monotonic_milliseconds());
+#endif // _MSC_VER
+
+    return probe_id;
+}
+
+void ProbeEngine::start_queued(uint64_t now_ms)
+{
+#ifndef _MSC_VER
+    while (!m_probe_queue.empty() && m_inflight < m_max_inflight)
+    {
+        const size_t probe_id = m_probe_queue.front();
+        m_probe_queue.pop_front();
+
+        std::map<size_t, Probe>::iterator iter = m_probe_map.find(probe_id);
+        if (m_probe_map.end() == iter || probe_queued != iter->second.state)
+        {
+            continue;
+        }
+
+        start(iter->second, probe_id, now_ms);
+        if (is_active(iter->second))
+        {
+            m_deadline_set.insert(std::make_pair(iter->second.deadline, probe_id));
+        }
+    }
+#endif // _MSC_VER
+}
+
+bool ProbeEngine::start(Probe & probe, size_t probe_id, uint64_t now_ms)
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    probe.deadline = now_ms + probe.timeout_ms;
+
+    /* a connection kept for a kind of probe the service does not use any more is closed */
+    std::map<std::string, Connection>::iterator iter_kept = m_connection_map.find(probe.endpoint->key);
+    if (m_connection_map.end() != iter_kept)
+    {
+        if (probe.persistent)
+        {
+            probe.state = probe_ok;
+            probe.error = 0;
+            return true;
+        }
+        close_socket(iter_kept->second.fd);
+        m_connection_map.erase(iter_kept);
+    }
+
+    std::map<std::string, Connection>::iterator iter_idle = m_idle_map.find(probe.endpoint->key);
+    if (m_idle_map.end() != iter_idle && !probe.http)
+    {
+        close_socket(iter_idle->second.fd);
+        m_idle_map.erase(iter_idle);
+    }
+
+    if (probe.http)
+    {
+        std::map<std::string, Connection>::iterator iter = m_idle_map.find(probe.endpoint->key);
+        if (m_idle_map.end() != iter)
+        {
+            probe.fd = iter->second.fd;
+            probe.reused = true;
+            m_idle_map.erase(iter);
+
+            ++m_inflight;
+            probe.state = probe_sending;
+
+            struct epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLOUT;
+            event.data.u64 = probe_id;
+            if (::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, probe.fd, &event) < 0)
+            {
+                return retry(probe, probe_id);
+            }
+
+            return true;
+        }
+    }
+
+    return connect(probe, probe_id);
+#endif // _MSC_VER
+}
+
+bool ProbeEngine::connect(Probe & probe, size_t probe_id)
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    const Endpoint & endpoint = *probe.endpoint;
+    if (0 == endpoint.address_size)
+    {
+        probe.state = probe_failed;
+        probe.error = EADDRNOTAVAIL;
+        return false;
+    }
+
+    probe.fd = ::socket(endpoint.address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (probe.fd < 0)
+    {
+        probe.state = probe_failed;
+        probe.error = errno;
+        return false;
+    }
+
+    ++m_inflight;
+    probe.state = probe_connecting;
+
+    int ret = ::connect(probe.fd, reinterpret_cast<const struct sockaddr *>(&endpoint.address), static_cast<socklen_t>(endpoint.address_size));
+    int error = errno;
+
+    if (0 == ret && !probe.http)
+    {
+        finish(probe, 0);
+        return true;
+    }
+
+    if (0 != ret && EINPROGRESS != error)
+    {
+        finish(probe, error);
+        return false;
+    }
+
+    /* an http probe which is connected at once sends as soon as the socket is writable */
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLOUT;
+    event.data.u64 = probe_id;
+    if (::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, probe.fd, &event) < 0)
+    {
+        finish(probe, errno);
+        return false;
+    }
+
+    return true;
+#endif // _MSC_VER
+}
+
+void ProbeEngine::advance(Probe & probe, size_t probe_id, uint32_t events)
+{
+#ifndef _MSC_VER
+    if (probe_connecting == probe.state)
+    {
+        int error = 0;
+        socklen_t error_size = sizeof(error);
+        if (0 != ::getsockopt(probe.fd, SOL_SOCKET, SO_ERROR, &error, &error_size))
+        {
+            error = errno;
+        }
+        else if (0 == error && 0 != (events & (EPOLLERR | EPOLLHUP)))
+        {
+            error = ECONNRESET;
+        }
+
+        if (0 != error || !probe.http)
+        {
+            finish(probe, error);
+            return;
+        }
+
+        probe.state = probe_sending;
+    }
+
+    if (probe_sending == probe.state)
+    {
+        while (probe.sent < probe.request.size())
+        {
+            ssize_t size = ::send(probe.fd, probe.request.data() + probe.sent, probe.request.size() - probe.sent, MSG_NOSIGNAL);
+            if (size < 0)
+            {
+                if (EINTR == errno)
+                {
+                    continue;
+                }
+                if (EAGAIN == errno || EWOULDBLOCK == errno)
+                {
+                    return;
+                }
+                int error = errno;
+                if (!retry(probe, probe_id))
+                {
+                    finish(probe, error);
+                }
+                return;
+            }
+            probe.sent += static_cast<size_t>(size);
+        }
+
+        probe.state = probe_receiving;
+
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.u64 = probe_id;
+        if (::epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, probe.fd, &event) < 0)
+        {
+            finish(probe, errno);
+        }
+        return;
+    }
+
+    if (probe_receiving == probe.state)
+    {
+        receive(probe, probe_id);
+    }
+#endif // _MSC_VER
+}
+
+void ProbeEngine::receive(Probe & probe, size_t probe_id)
+{
+#ifndef _MSC_VER
+    bool eof = false;
+    char buffer[4096];
+    while (probe.response.size() <= s_max_response_size)
+    {
+        ssize_t size = ::recv(probe.fd, buffer, sizeof(buffer), 0);
+        if (size > 0)
+        {
+            probe.response.append(buffer, static_cast<size_t>(size));
+            continue;
+        }
+        if (0 == size)
+        {
+            eof = true;
+            break;
+        }
+        if (EINTR == errno)
+        {
+            continue;
+        }
+        if (EAGAIN == errno || EWOULDBLOCK == errno)
+        {
+            break;
+        }
+
+        int error = errno;
+        if (!retry(probe, probe_id))
+        {
+            finish(probe, error);
+        }
+        return;
+    }
+
+    std::string body;
+    bool keep_alive = false;
+    size_t consumed = 0;
+    HttpParseResult result = parse_http_response(probe.response, eof, probe.status, keep_alive, body, consumed);
+    if (http_incomplete == result)
+    {
+        if (probe.response.size() > s_max_response_size)
+        {
+            finish(probe, EMSGSIZE);
+        }
+        else if (eof && !retry(probe, probe_id))
+        {
+            finish(probe, ECONNRESET);
+        }
+        return;
+    }
+
+    if (http_bad == result)
+    {
+        finish(probe, EPROTO);
+        return;
+    }
+
+    /* bytes after the response leave the connection out of step, it is not reused then */
+    probe.keep_alive = (keep_alive && !eof && consumed == probe.response.size());
+
+    bool ok = (probe.expect_status == probe.status && (probe.expect_body.empty() || std::string::npos != body.find(probe.expect_body)));
+    finish(probe, ok ? 0 : EPROTO);
+#endif // _MSC_VER
+}
+
+/*
+ * a kept alive connection may have been closed by the server while it was idle,
+ * which shows up before any byte of the response, it is connected again then
+ */
+bool ProbeEngine::retry(Probe & probe, size_t probe_id)
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    if (!probe.reused || !probe.response.empty())
+    {
+        return false;
+    }
+
+    close_socket(probe.fd);
+    probe.fd = -1;
+    --m_inflight;
+
+    probe.reused = false;
+    probe.sent = 0;
+    connect(probe, probe_id);
+
+    return true;
+#endif // _MSC_VER
+}
+
+void ProbeEngine::finish(Probe & probe, int error)
+{
+#ifndef _MSC_VER
+    m_deadline_set.erase(std::make_pair(probe.deadline, probe.id));
+
+    if (probe.fd >= 0)
+    {
+        if (0 == error && probe.persistent)
+        {
+            keep(probe);
+        }
+        else if (probe.keep_alive)
+        {
+            keep_idle(probe);
+        }
+        else
+        {
+            /* closing the only reference also takes the socket out of the epoll set */
+            close_socket(probe.fd);
+        }
+        probe.fd = -1;
+        --m_inflight;
+    }
+#endif // _MSC_VER
+
+    probe.state = (0 == error ? probe_ok : probe_failed);
+    probe.error = error;
+}
+
+void ProbeEngine::keep(Probe & probe)
+{
+#ifndef _MSC_VER
+    const std::string & key = probe.endpoint->key;
+
+    /* a connect which finished at once is not in the epoll set, the error is ignored then */
+    ::epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, probe.fd, nullptr);
+
+    if (m_connection_map.end() != m_connection_map.find(key))
+    {
+        close_socket(probe.fd);
+        return;
+    }
+
+    int keep_alive = 1;
+    int keep_idle = 10;
+    int keep_interval = 5;
+    int keep_count = 3;
+    ::setsockopt(probe.fd, SOL_SOCKET, SO_KEEPALIVE, &keep_alive, sizeof(keep_alive));
+    ::setsockopt(probe.fd, IPPROTO_TCP, TCP_KEEPIDLE, &keep_idle, sizeof(keep_idle));
+    ::setsockopt(probe.fd, IPPROTO_TCP, TCP_KEEPINTVL, &keep_interval, sizeof(keep_interval));
+    ::setsockopt(probe.fd, IPPROTO_TCP, TCP_KEEPCNT, &keep_count, sizeof(keep_count));
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLRDHUP;
+    event.data.fd = probe.fd;
+    if (::epoll_ctl(m_watch_fd, EPOLL_CTL_ADD, probe.fd, &event) < 0)
+    {
+        RUN_LOG_ERR("epoll_ctl(add probe connection %s) failed: %d", key.c_str(), stupid_system_error());
+        close_socket(probe.fd);
+        return;
+    }
+
+    Connection connection;
+    connection.fd = probe.fd;
+    m_connection_map[key] = connection;
+#endif // _MSC_VER
+}
+
+/*
+ * an idle http connection is out of every epoll set until the next check,
+ * one per "host:port" is kept
+ */
+void ProbeEngine::keep_idle(Probe & probe)
+{
+#ifndef _MSC_VER
+    const std::string & key = probe.endpoint->key;
+
+    ::epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, probe.fd, nullptr);
+
+    if (m_idle_map.end() != m_idle_map.find(key))
+    {
+        close_socket(probe.fd);
+        return;
+    }
+
+    Connection connection;
+    connection.fd = probe.fd;
+    m_idle_map[key] = connection;
+#endif // _MSC_VER
+}
@@ -0,0 +1,232 @@
+/********************************************************
+ * Description : process event stream of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#include "net/common/common.h"
+
+#ifndef _MSC_VER
+    #include <errno.h>
+    #include <unistd.h>
+    #include <sys/socket.h>
+    #include <linux/netlink.h>
+    #include <linux/connector.h>
+    #include <linux/cn_proc.h>
+#endif // _MSC_VER
+
+#include <cstring>
+
+#include "base/log/log.h"
+#include "proc_connector.h"
+
+#ifndef _MSC_VER
+
+static bool send_operation(int socket, int operation)
+{
+    const size_t payload_size = sizeof(struct cn_msg) + sizeof(int);
+    union
+    {
+        struct nlmsghdr     header;
+        char                buff[NLMSG_SPACE(payload_size)];
+    } request;
+    memset(&request, 0x00, sizeof(request));
+
+    request.header.nlmsg_len = NLMSG_LENGTH(payload_size);
+    request.header.nlmsg_type = NLMSG_DONE;
+    request.header.nlmsg_pid = static_cast<__u32>(::getpid());
+
+    struct cn_msg * message = reinterpret_cast<struct cn_msg *>(NLMSG_DATA(&request.header));
+    message->id.idx = CN_IDX_PROC;
+    message->id.val = CN_VAL_PROC;
+    message->len = sizeof(int);
+    memcpy(message->data, &operation, sizeof(operation));
+
+    return (::send(socket, &request, request.header.nlmsg_len, 0) >= 0);
+}
+
+#endif // _MSC_VER
+
+ProcEventStream::ProcEventStream()
+    : m_socket(-1)
+    , m_listening(false)
+    , m_buffer()
+{
+
+}
+
+ProcEventStream::~ProcEventStream()
+{
+    exit();
+}
+
+bool ProcEventStream::init()
+{
+    exit();
+
+#ifdef _MSC_VER
+    return false;
+#else
+    m_socket = ::socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (m_socket < 0)
+    {
+        RUN_LOG_ERR("socket(NETLINK_CONNECTOR) failed: %d", stupid_system_error());
+        return false;
+    }
+
+    /* a burst of forks must not overrun the socket between two reads */
+    int buffer_size = 4 * 1024 * 1024;
+    if (::setsockopt(m_socket, SOL_SOCKET, SO_RCVBUFFORCE, &buffer_size, sizeof(buffer_size)) < 0)
+    {
+        ::setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    }
+
+    struct sockaddr_nl address;
+    memset(&address, 0x00, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = CN_IDX_PROC;
+    if (::bind(m_socket, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        RUN_LOG_ERR("bind(CN_IDX_PROC) failed: %d", stupid_system_error());
+        exit();
+        return false;
+    }
+
+    if (!send_operation(m_socket, PROC_CN_MCAST_LISTEN))
+    {
+        RUN_LOG_ERR("send(PROC_CN_MCAST_LISTEN) failed: %d", stupid_system_error());
+        exit();
+        return false;
+    }
+    m_listening = true;
+
+    m_buffer.resize(64 * 1024);
+
+    return true;
+#endif // _MSC_VER
+}
+
+void ProcEventStream::exit()
+{
+#ifndef _MSC_VER
+    if (m_socket >= 0)
+    {
+        /* the kernel counts the listeners, and sends no events when there is none */
+        if (m_listening && !send_operation(m_socket, PROC_CN_MCAST_IGNORE))
+        {
+            RUN_LOG_ERR("send(PROC_CN_MCAST_IGNORE) failed: %d", stupid_system_error());
+        }
+        m_listening = false;
+        ::close(m_socket);
+        m_socket = -1;
+    }
+#endif // _MSC_VER
+}
+
+bool ProcEventStream::is_open() const
+{
+    return m_socket >= 0;
+}
+
+int ProcEventStream::fd() const
+{
+    return m_socket;
+}
+
+bool ProcEventStream::read(std::vector<ProcEvent> & event_list)
+{
+    event_list.clear();
+
+#ifdef _MSC_VER
+    return false;
+#else
+    if (m_socket < 0)
+    {
+        return false;
+    }
+
+    while (true)
+    {
+        ssize_t size = ::recv(m_socket, &m_buffer[0], m_buffer.size(), 0);
+        if (size < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            if (EAGAIN == errno || EWOULDBLOCK == errno)
+            {
+                return true;
+            }
+            if (ENOBUFS != errno)
+            {
+                RUN_LOG_ERR("recv(NETLINK_CONNECTOR) failed: %d", stupid_system_error());
+            }
+            return false;
+        }
+
+        int length = static_cast<int>(size);
+        for (const struct nlmsghdr * header = reinterpret_cast<const struct nlmsghdr *>(&m_buffer[0]); NLMSG_OK(header, length); header = NLMSG_NEXT(header, length))
+        {
+            if (NLMSG_ERROR == header->nlmsg_type || NLMSG_OVERRUN == header->nlmsg_type)
+            {
+                return false;
+            }
+            if (NLMSG_NOOP == header->nlmsg_type)
+            {
+                continue;
+            }
+
+            const struct cn_msg * message = reinterpret_cast<const struct cn_msg *>(NLMSG_DATA(header));
+            if (CN_IDX_PROC != message->id.idx || CN_VAL_PROC != message->id.val)
+            {
+                continue;
+            }
+
+            const struct proc_event * event = reinterpret_cast<const struct proc_event *>(message->data);
+
+            ProcEvent proc_event;
+            switch (event->what)
+            {
+                case proc_event::PROC_EVENT_FORK:
+                {
+                    if (event->event_data.fork.child_pid != event->event_data.fork.child_tgid)
+                    {
+                        continue; /* a new thread */
+                    }
+                    proc_event.type = ProcEvent::fork_event;
+                    proc_event.pid = static_cast<size_t>(event->event_data.fork.child_tgid);
+                    break;
+                }
+                case proc_event::PROC_EVENT_EXEC:
+                {
+                    proc_event.type = ProcEvent::exec_event;
+                    proc_event.pid = static_cast<size_t>(event->event_data.exec.process_tgid);
+                    break;
+                }
+                case proc_event::PROC_EVENT_EXIT:
+                {
+                    if (event->event_data.exit.process_pid != event->event_data.exit.process_tgid)
+                    {
+                        continue; /* a thread exits */
+                    }
+                    proc_event.type = ProcEvent::exit_event;
+                    proc_event.pid = static_cast<size_t>(event->event_data.exit.process_tgid);
+                    break;
+                }
+                default:
+                {
+                    continue;
+                }
+            }
+
+            event_list.push_back(proc_event);
+        }
+    }
+#endif // _MSC_VER
+}
@@ -0,0 +1,577 @@
+/********************************************************
+ * Description : process launcher of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#ifndef _MSC_VER
+    #include <sched.h>
+    #include <linux/mempolicy.h>
+    #include <errno.h>
+    #include <unistd.h>
+    #include <signal.h>
+    #include <pthread.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <sys/resource.h>
+#endif // _MSC_VER
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "process_launcher.h"
+
+#ifdef _MSC_VER
+    #define environ _environ
+#else
+    extern char ** environ;
+#endif // _MSC_VER
+
+static void split_param(const std::string & param, std::vector<std::string> & args)
+{
+    std::string arg;
+    bool in_arg = false;
+    bool in_quote = false;
+
+    for (std::string::const_iterator iter = param.begin(); param.end() != iter; ++iter)
+    {
+        const char c = *iter;
+        if ('"' == c)
+        {
+            in_quote = !in_quote;
+            in_arg = true;
+        }
+        else if (!in_quote && (' ' == c || '\t' == c || '\r' == c || '\n' == c))
+        {
+            if (in_arg)
+            {
+                args.push_back(arg);
+                arg.clear();
+                in_arg = false;
+            }
+        }
+        else
+        {
+            arg += c;
+            in_arg = true;
+        }
+    }
+
+    if (in_arg)
+    {
+        args.push_back(arg);
+    }
+}
+
+static void resolve_file(const std::string & file, std::string & resolved_file)
+{
+    resolved_file = file;
+
+#ifndef _MSC_VER
+    /*
+     * the child changes its directory before execve, a relative file would
+     * be wrong there, so it is made absolute against the daemon's directory;
+     * symlinks are kept, the link is followed by execve at every start
+     * (a "current -> releases/vN" switch is taken by the next start)
+     */
+    if (!resolved_file.empty() && '/' != resolved_file[0])
+    {
+        char current_directory[4096] = { 0 };
+        if (nullptr != ::getcwd(current_directory, sizeof(current_directory)))
+        {
+            resolved_file = std::string(current_directory) + "/" + resolved_file;
+        }
+    }
+#endif // _MSC_VER
+}
+
+LaunchSpec::LaunchSpec()
+    : m_block(nullptr)
+    , m_block_size(0)
+    , m_argv(nullptr)
+    , m_envp(nullptr)
+    , m_file(nullptr)
+    , m_work_directory(nullptr)
+    , m_command_line()
+    , m_limits()
+    , m_has_scheduling(false)
+    , m_scheduling()
+{
+
+}
+
+LaunchSpec::LaunchSpec(const LaunchSpec & other)
+    : m_block(nullptr)
+    , m_block_size(0)
+    , m_argv(nullptr)
+    , m_envp(nullptr)
+    , m_file(nullptr)
+    , m_work_directory(nullptr)
+    , m_command_line()
+    , m_limits()
+    , m_has_scheduling(false)
+    , m_scheduling()
+{
+    copy_from(other);
+}
+
+LaunchSpec & LaunchSpec::operator = (const LaunchSpec & other)
+{
+    if (&other != this)
+    {
+        clear();
+        copy_from(other);
+    }
+    return *this;
+}
+
+LaunchSpec::~LaunchSpec()
+{
+    clear();
+}
+
+void LaunchSpec::clear()
+{
+    ::free(m_block);
+    m_block = nullptr;
+    m_block_size = 0;
+    m_argv = nullptr;
+    m_envp = nullptr;
+    m_file = nullptr;
+    m_work_directory = nullptr;
+    m_command_line.clear();
+    m_limits.clear();
+    m_has_scheduling = false;
+}
+
+void LaunchSpec::copy_from(const LaunchSpec & other)
+{
+    m_command_line = other.m_command_line;
+    m_limits = other.m_limits;
+    m_has_scheduling = other.m_has_scheduling;
+    m_scheduling = other.m_scheduling;
+
+    if (nullptr == other.m_block)
+    {
+        return;
+    }
+
+    m_block = reinterpret_cast<char *>(::malloc(other.m_block_size));
+    if (nullptr == m_block)
+    {
+        m_command_line.clear();
+        return;
+    }
+    memcpy(m_block, other.m_block, other.m_block_size);
+    m_block_size = other.m_block_size;
+
+    /* every pointer points into the block, move them to the new block */
+    m_argv = reinterpret_cast<char **>(m_block + (reinterpret_cast<char *>(other.m_argv) - other.m_block));
+    m_envp = reinterpret_cast<char **>(m_block + (reinterpret_cast<char *>(other.m_envp) - other.m_block));
+    m_file = m_block + (other.m_file - other.m_block);
+    m_work_directory = m_block + (other.m_work_directory - other.m_block);
+    for (char ** pointer = m_argv; nullptr != *pointer; ++pointer)
+    {
+        *pointer = m_block + (*pointer - other.m_block);
+    }
+    for (char ** pointer = m_envp; nullptr != *pointer; ++pointer)
+    {
+        *pointer = m_block + (*pointer - other.m_block);
+    }
+}
+
+bool LaunchSpec::build(const std::string & path, const std::string & file, const std::list<std::string> & params, const std::list<std::string> & envs)
+{
+    clear();
+
+    if (file.empty())
+    {
+        return false;
+    }
+
+    /* argv[0] is the file as it is configured, a multi-call binary behind a symlink looks at it */
+    std::vector<std::string> args;
+    args.push_back(path + file);
+    std::string exec_file;
+    resolve_file(args[0], exec_file);
+    for (std::list<std::string>::const_iterator iter = params.begin(); params.end() != iter; ++iter)
+    {
+        split_param(*iter, args);
+    }
+
+    std::vector<std::string> env_list;
+    for (char ** env = environ; nullptr != env && nullptr != *env; ++env)
+    {
+        env_list.push_back(*env);
+    }
+    for (std::list<std::string>::const_iterator iter = envs.begin(); envs.end() != iter; ++iter)
+    {
+        std::string::size_type equal = iter->find('=');
+        if (std::string::npos == equal || 0 == equal)
+        {
+            continue;
+        }
+
+        std::vector<std::string>::iterator iter_env = env_list.begin();
+        for (; env_list.end() != iter_env; ++iter_env)
+        {
+            if (0 == iter_env->compare(0, equal + 1, *iter, 0, equal + 1))
+            {
+                *iter_env = *iter;
+                break;
+            }
+        }
+        if (env_list.end() == iter_env)
+        {
+            env_list.push_back(*iter);
+        }
+    }
+
+    size_t string_size = exec_file.size() + 1 + path.size() + 1;
+    for (std::vector<std::string>::const_iterator iter = args.begin(); args.end() != iter; ++iter)
+    {
+        string_size += iter->size() + 1;
+    }
+    for (std::vector<std::string>::const_iterator iter = env_list.begin(); env_list.end() != iter; ++iter)
+    {
+        string_size += iter->size() + 1;
+    }
+
+    const size_t pointer_size = (args.size() + 1 + env_list.size() + 1) * sizeof(char *);
+
+    m_block_size = pointer_size + string_size;
+    m_block = reinterpret_cast<char *>(::malloc(m_block_size));
+    if (nullptr == m_block)
+    {
+        m_block_size = 0;
+        return false;
+    }
+
+    m_argv = reinterpret_cast<char **>(m_block);
+    m_envp = m_argv + args.size() + 1;
+
+    char * position = m_block + pointer_size;
+
+    memcpy(position, exec_file.c_str(), exec_file.size() + 1);
+    m_file = position;
+    position += exec_file.size() + 1;
+
+    memcpy(position, path.c_str(), path.size() + 1);
+    m_work_directory = position;
+    position += path.size() + 1;
+
+    for (size_t index = 0; index < args.size(); ++index)
+    {
+        memcpy(position, args[index].c_str(), args[index].size() + 1);
+        m_argv[index] = position;
+        position += args[index].size() + 1;
+
+        if (0 != index)
+        {
+            m_command_line += ' ';
+        }
+        m_command_line += args[index];
+    }
+    m_argv[args.size()] = nullptr;
+
+    for (size_t index = 0; index < env_list.size(); ++index)
+    {
+        memcpy(position, env_list[index].c_str(), env_list[index].size() + 1);
+        m_envp[index] = position;
+        position += env_list[index].size() + 1;
+    }
+    m_envp[env_list.size()] = nullptr;
+
+    return true;
+}
+
+void LaunchSpec::set_limits(const std::vector<SpawnLimit> & limits)
+{
+    m_limits = limits;
+}
+
+void LaunchSpec::set_scheduling(const SpawnScheduling & scheduling)
+{
+    m_scheduling = scheduling;
+    m_has_scheduling = true;
+}
+
+bool LaunchSpec::empty() const
+{
+    return nullptr == m_block;
+}
+
+const char * LaunchSpec::file() const
+{
+    return m_file;
+}
+
+const char * LaunchSpec::work_directory() const
+{
+    return m_work_directory;
+}
+
+char * const * LaunchSpec::argv() const
+{
+    return m_argv;
+}
+
+char * const * LaunchSpec::envp() const
+{
+    return m_envp;
+}
+
+const std::string & LaunchSpec::command_line() const
+{
+    return m_command_line;
+}
+
+const std::vector<SpawnLimit> & LaunchSpec::limits() const
+{
+    return m_limits;
+}
+
+const SpawnScheduling * LaunchSpec::scheduling() const
+{
+    return (m_has_scheduling ? &m_scheduling : nullptr);
+}
+
+#ifndef _MSC_VER
+
+struct SpawnContext
+{
+    const SpawnAttributes *     attributes;
+    sigset_t                    parent_mask;
+    volatile int                error;
+    const char * volatile       error_step;
+    volatile int                chdir_error;
+    volatile int                cgroup_error;
+};
+
+/*
+ * runs in the child, the error step is nullptr if everything is set,
+ * mempolicy, affinity, ioprio, policy and nice are all kept by execv
+ */
+static const char * apply_scheduling(const SpawnScheduling & scheduling)
+{
+    if (scheduling.numa_mode >= 0)
+    {
+        const unsigned long * node_mask = (MPOL_DEFAULT == scheduling.numa_mode || MPOL_LOCAL == scheduling.numa_mode) ? nullptr : reinterpret_cast<const unsigned long *>(scheduling.node_mask);
+        const unsigned long max_node = (nullptr == node_mask ? 0 : SpawnScheduling::mask_words * 64 + 1);
+        if (0 != ::syscall(SYS_set_mempolicy, scheduling.numa_mode, node_mask, max_node))
+        {
+            return "set_mempolicy";
+        }
+    }
+
+    if (scheduling.set_cpus && 0 != ::sched_setaffinity(0, sizeof(scheduling.cpu_mask), reinterpret_cast<const cpu_set_t *>(scheduling.cpu_mask)))
+    {
+        return "sched_setaffinity";
+    }
+
+    if (scheduling.ioprio >= 0 && 0 != ::syscall(SYS_ioprio_set, 1 /* IOPRIO_WHO_PROCESS */, 0, scheduling.ioprio))
+    {
+        return "ioprio_set";
+    }
+
+    if (scheduling.policy >= 0)
+    {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = scheduling.priority;
+        if (0 != ::sched_setscheduler(0, scheduling.policy, &param))
+        {
+            return "sched_setscheduler";
+        }
+    }
+
+    if (scheduling.set_nice && 0 != ::setpriority(PRIO_PROCESS, 0, scheduling.nice))
+    {
+        return "setpriority";
+    }
+
+    return nullptr;
+}
+
+/*
+ * runs in the child, on its own stack but in the memory of the daemon,
+ * the daemon thread is suspended until execv succeeds or this returns
+ */
+static int spawn_child(void * argument)
+{
+    SpawnContext & context = *reinterpret_cast<SpawnContext *>(argument);
+    const SpawnAttributes & attributes = *context.attributes;
+
+    /*
+     * join the cgroup and the new process group before anything else,
+     * so every process the service forks is in them too
+     */
+    bool in_cgroup = false;
+    if (attributes.cgroup_procs_fd >= 0)
+    {
+        if (1 == ::write(attributes.cgroup_procs_fd, "0", 1))
+        {
+            in_cgroup = true;
+        }
+        else
+        {
+            context.cgroup_error = errno;
+        }
+    }
+
+    if (attributes.new_process_group)
+    {
+        ::setpgid(0, 0);
+    }
+
+    /*
+     * limits are inherited by every process the service forks,
+     * a hard limit above the current one can not be set, so the soft one is lowered only
+     */
+    if (!in_cgroup || !attributes.limits_in_cgroup)
+    {
+        for (size_t index = 0; index < attributes.limit_count; ++index)
+        {
+            struct rlimit limit;
+            limit.rlim_cur = static_cast<rlim_t>(attributes.limits[index].value);
+            limit.rlim_max = static_cast<rlim_t>(attributes.limits[index].value);
+            if (0 != ::setrlimit(attributes.limits[index].resource, &limit) && 0 == ::getrlimit(attributes.limits[index].resource, &limit))
+            {
+                if (limit.rlim_cur > static_cast<rlim_t>(attributes.limits[index].value))
+                {
+                    limit.rlim_cur = static_cast<rlim_t>(attributes.limits[index].value);
+                    ::setrlimit(attributes.limits[index].resource, &limit);
+                }
+            }
+        }
+    }
+
+    if (nullptr != attributes.scheduling)
+    {
+        const char * error_step = apply_scheduling(*attributes.scheduling);
+        if (nullptr != error_step)
+        {
+            context.error = errno;
+            context.error_step = error_step;
+            return 127;
+        }
+    }
+
+    /*
+     * the handler table is a copy (no CLONE_SIGHAND), so handlers of the daemon
+     * can be reset here, then no signal is blocked in the service
+     */
+    for (int signo = 1; signo < NSIG; ++signo)
+    {
+        struct sigaction action;
+        if (0 == ::sigaction(signo, nullptr, &action) && SIG_IGN != action.sa_handler && SIG_DFL != action.sa_handler)
+        {
+            action.sa_handler = SIG_DFL;
+            action.sa_flags = 0;
+            ::sigaction(signo, &action, nullptr);
+        }
+    }
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    ::sigprocmask(SIG_SETMASK, &mask, nullptr);
+
+    if (nullptr != attributes.work_directory && 0 != ::chdir(attributes.work_directory))
+    {
+        context.chdir_error = errno;
+    }
+
+    if (attributes.close_stdio)
+    {
+        ::close(STDIN_FILENO);
+        ::close(STDOUT_FILENO);
+        ::close(STDERR_FILENO);
+    }
+
+    if (nullptr != attributes.envp)
+    {
+        ::execve(attributes.file, attributes.argv, attributes.envp);
+    }
+    else
+    {
+        ::execv(attributes.file, attributes.argv);
+    }
+
+    context.error = errno;
+    context.error_step = "execve";
+
+    return 127;
+}
+
+#endif // _MSC_VER
+
+bool spawn_process(const SpawnAttributes & attributes, SpawnResult & result)
+{
+    result.pid = 0;
+    result.error = 0;
+    result.error_step = "";
+    result.chdir_error = 0;
+    result.cgroup_error = 0;
+
+#ifdef _MSC_VER
+    result.error_step = "spawn";
+    return false;
+#else
+    const size_t stack_size = 64 * 1024;
+    void * stack = ::mmap(nullptr, stack_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (MAP_FAILED == stack)
+    {
+        result.error = errno;
+        result.error_step = "mmap";
+        return false;
+    }
+
+    SpawnContext context;
+    context.attributes = &attributes;
+    context.error = 0;
+    context.error_step = "";
+    context.chdir_error = 0;
+    context.cgroup_error = 0;
+
+    /*
+     * no signal handler of the daemon may run in the child before it resets them
+     */
+    sigset_t all_mask;
+    sigfillset(&all_mask);
+    ::pthread_sigmask(SIG_BLOCK, &all_mask, &context.parent_mask);
+
+    pid_t pid = ::clone(spawn_child, reinterpret_cast<char *>(stack) + stack_size, CLONE_VM | CLONE_VFORK | SIGCHLD, &context);
+    int clone_error = errno;
+
+    ::pthread_sigmask(SIG_SETMASK, &context.parent_mask, nullptr);
+
+    ::munmap(stack, stack_size);
+
+    if (pid < 0)
+    {
+        result.error = clone_error;
+        result.error_step = "clone";
+        return false;
+    }
+
+    result.pid = static_cast<size_t>(pid);
+    result.chdir_error = context.chdir_error;
+    result.cgroup_error = context.cgroup_error;
+
+    if (0 != context.error)
+    {
+        /* the child has exited already, the reaper collects it */
+        result.error = context.error;
+        result.error_step = context.error_step;
+        return false;
+    }
+
+    return true;
+#endif // _MSC_VER
+}
@@ -0,0 +1,250 @@
+/********************************************************
+ * Description : process stopper of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#include "net/common/common.h"
+
+#ifdef _MSC_VER
+    #include <windows.h>
+#else
+    #include <errno.h>
+    #include <signal.h>
+    #include <sys/types.h>
+#endif // _MSC_VER
+
+#include <algorithm>
+
+#include "base/log/log.h"
+#include "base/utility/utility.h"
+#include "process_table.h"
+#include "process_stopper.h"
+#include "utility.h"
+
+/*
+ * after SIGKILL, the tree is normally empty in a few milliseconds,
+ * if it is not, SIGKILL is sent again every this long
+ * (processes forked while the signal was sent one by one)
+ */
+static const uint64_t killed_recheck_ms = 1000;
+
+/*
+ * a process group raises no event when its last process is gone,
+ * so the tree of a service without a cgroup is looked at this often
+ * (the exit of the main process and "populated 0" of a cgroup wake the daemon)
+ */
+static const uint64_t group_recheck_ms = 100;
+
+ProcessStopper::ProcessStopper(CgroupManager & cgroup_manager)
+    : m_cgroup_manager(cgroup_manager)
+    , m_stop_map()
+    , m_last_check_time(0)
+{
+
+}
+
+bool ProcessStopper::stop(const PROCESS_IDENTITY & process_identity, const std::string & cgroup_name, uint64_t grace_ms)
+{
+    const size_t process_id = process_identity.pid;
+
+    if (0 == process_id)
+    {
+        return false;
+    }
+
+    if (Stupid::Base::get_pid() == process_id)
+    {
+        RUN_LOG_CRI("stop process exception: why do you stop current process?");
+        return false;
+    }
+
+    if (is_stopping(process_id))
+    {
+        return true;
+    }
+
+#ifdef _MSC_VER
+    const bool force = true;
+#else
+    const bool force = (0 == grace_ms);
+#endif // _MSC_VER
+
+    const uint64_t now_ms = get_monotonic_milliseconds();
+    StopInfo stop_info = { process_identity, cgroup_name, now_ms + (force ? killed_recheck_ms : grace_ms), force, force ? now_ms : 0 };
+
+    if (!is_running(stop_info))
+    {
+        RUN_LOG_DBG("process %u is not exist", process_id);
+        return false;
+    }
+
+    if (!send_signal(stop_info, force))
+    {
+        RUN_LOG_ERR("stop process %u failure", process_id);
+    }
+
+    m_stop_map[process_id] = stop_info;
+
+    RUN_LOG_DBG("stop process %u with %s", process_id, force ? "SIGKILL" : "SIGTERM");
+
+    return true;
+}
+
+void ProcessStopper::check(uint64_t now_ms, std::vector<size_t> & stopped_list)
+{
+    m_last_check_time = now_ms;
+
+    std::map<size_t, StopInfo>::iterator iter = m_stop_map.begin();
+    while (m_stop_map.end() != iter)
+    {
+        const size_t process_id = iter->first;
+        StopInfo & stop_info = iter->second;
+
+        bool running = is_running(stop_info);
+
+        /*
+         * a process group which is killed is empty in a few milliseconds,
+         * if it is not, the pgid may be taken by another group already
+         * (see is_running), it is not waited and not killed any more
+         */
+        if (running && stop_info.cgroup.empty() && stop_info.killed && now_ms >= stop_info.kill_time + group_recheck_ms && !is_process_alive(stop_info.identity))
+        {
+            RUN_LOG_ERR("process group %u is still found %ums after SIGKILL, stop waiting for it", process_id, static_cast<size_t>(now_ms - stop_info.kill_time));
+            running = false;
+        }
+
+        if (!running)
+        {
+            RUN_LOG_DBG("process %u is stopped", process_id);
+            stopped_list.push_back(process_id);
+            m_stop_map.erase(iter++);
+            continue;
+        }
+
+        if (now_ms < stop_info.deadline)
+        {
+            ++iter;
+            continue;
+        }
+
+        if (!stop_info.killed)
+        {
+            RUN_LOG_ERR("process %u is still alive after grace period, kill it", process_id);
+            stop_info.killed = true;
+            stop_info.kill_time = now_ms;
+        }
+        send_signal(stop_info, true);
+
+        stop_info.deadline = now_ms + killed_recheck_ms;
+        ++iter;
+    }
+}
+
+uint64_t ProcessStopper::next_check_time() const
+{
+    uint64_t next_time = UINT64_MAX;
+    for (std::map<size_t, StopInfo>::const_iterator iter = m_stop_map.begin(); m_stop_map.end() != iter; ++iter)
+    {
+        next_time = std::min(next_time, iter->second.deadline);
+        if (iter->second.cgroup.empty())
+        {
+            next_time = std::min(next_time, m_last_check_time + group_recheck_ms);
+        }
+    }
+    return next_time;
+}
+
+bool ProcessStopper::is_stopping(size_t process_id) const
+{
+    return (m_stop_map.end() != m_stop_map.find(process_id));
+}
+
+size_t ProcessStopper::size() const
+{
+    return (m_stop_map.size());
+}
+
+bool ProcessStopper::is_running(const StopInfo & stop_info) const
+{
+    /*
+     * the pid may be reused once the process is gone,
+     * so look at the identity of the process, not only the pid
+     */
+    if (is_process_alive(stop_info.identity))
+    {
+        return true;
+    }
+
+#ifdef _MSC_VER
+    return false;
+#else
+    if (!stop_info.cgroup.empty())
+    {
+        return m_cgroup_manager.is_populated(stop_info.cgroup);
+    }
+
+    /*
+     * the pid of the main process is not given to a new process while any
+     * process is in its group, so another process with that pid means the
+     * group is gone, and the pgid may be of a group which is not ours
+     */
+    PROCESS_IDENTITY current_identity;
+    if (get_process_identity(stop_info.identity.pid, current_identity))
+    {
+        return false;
+    }
+
+    return (0 == ::kill(-static_cast<pid_t>(stop_info.identity.pid), 0) || EPERM == stupid_system_error());
+#endif // _MSC_VER
+}
+
+bool ProcessStopper::send_signal(const StopInfo & stop_info, bool force)
+{
+    const size_t process_id = stop_info.identity.pid;
+
+#ifdef _MSC_VER
+    HANDLE process = ::OpenProcess(PROCESS_TERMINATE, FALSE, static_cast<DWORD>(process_id));
+    if (nullptr == process)
+    {
+        RUN_LOG_ERR("open process %u failed: %d", process_id, stupid_system_error());
+        return false;
+    }
+    bool ret = (FALSE != ::TerminateProcess(process, 9));
+    if (!ret)
+    {
+        RUN_LOG_ERR("terminate process %u failed: %d", process_id, stupid_system_error());
+    }
+    ::CloseHandle(process);
+    return ret;
+#else
+    const int signo = (force ? SIGKILL : SIGTERM);
+
+    bool ret = true;
+
+    if (!stop_info.cgroup.empty())
+    {
+        ret = (force ? m_cgroup_manager.kill(stop_info.cgroup) : m_cgroup_manager.signal(stop_info.cgroup, signo));
+    }
+
+    if (::kill(-static_cast<pid_t>(process_id), signo) < 0 && ESRCH != stupid_system_error())
+    {
+        RUN_LOG_ERR("send %s to process group %u failed: %d", force ? "SIGKILL" : "SIGTERM", process_id, stupid_system_error());
+        ret = false;
+    }
+
+    /* the main process may have left its process group */
+    if (is_process_alive(stop_info.identity) && ::kill(static_cast<pid_t>(process_id), signo) < 0 && ESRCH != stupid_system_error())
+    {
+        RUN_LOG_ERR("send %s to process %u failed: %d", force ? "SIGKILL" : "SIGTERM", process_id, stupid_system_error());
+        ret = false;
+    }
+
+    return ret;
+#endif // _MSC_VER
+}
@@ -0,0 +1,905 @@
+/********************************************************
+ * Description : process table of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#include "net/common/common.h"
+
+#ifdef _MSC_VER
+    #include <windows.h>
+    #include <tlhelp32.h>
+#else
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <dirent.h>
+    #include <sys/syscall.h>
+#endif // _MSC_VER
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <algorithm>
+
+#include "base/log/log.h"
+#include "process_table.h"
+
+/*
+ * called once for every process in the table,
+ * args is the command line with arguments separated by '\0' (no trailing '\0')
+ */
+typedef void (*process_visitor_t)(void * context, size_t pid, const char * args, size_t size);
+
+#ifndef _MSC_VER
+
+struct linux_dirent64
+{
+    uint64_t        d_ino;
+    int64_t         d_off;
+    unsigned short  d_reclen;
+    unsigned char   d_type;
+    char            d_name[1];
+};
+
+static bool parse_pid(const char * name, size_t & pid)
+{
+    if ('\0' == *name)
+    {
+        return false;
+    }
+
+    pid = 0;
+    for (; '\0' != *name; ++name)
+    {
+        if (*name < '0' || *name > '9')
+        {
+            return false;
+        }
+        pid = pid * 10 + static_cast<size_t>(*name - '0');
+    }
+
+    return true;
+}
+
+static bool read_cmdline(int dir_fd, const char * pid_directory, std::string & args)
+{
+    char file_name[64] = { 0 };
+    snprintf(file_name, sizeof(file_name), "%s/cmdline", pid_directory);
+
+    int fd = ::openat(dir_fd, file_name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false; /* process exited while scanning */
+    }
+
+    args.clear();
+
+    char buff[4096];
+    while (true)
+    {
+        ssize_t size = ::read(fd, buff, sizeof(buff));
+        if (size > 0)
+        {
+            args.append(buff, static_cast<size_t>(size));
+        }
+        else if (size < 0 && EINTR == errno)
+        {
+            continue;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    ::close(fd);
+
+    while (!args.empty() && '\0' == *args.rbegin())
+    {
+        args.erase(args.size() - 1);
+    }
+
+    return true;
+}
+
+/*
+ * read field 22 (start time) of <pid_directory>/stat,
+ * false if the process is exited or a zombie
+ */
+static bool read_start_time(int dir_fd, const char * pid_directory, uint64_t & start_time)
+{
+    char file_name[64] = { 0 };
+    snprintf(file_name, sizeof(file_name), "%s/stat", pid_directory);
+
+    int fd = ::openat(dir_fd, file_name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    /* the fields up to the start time are far less than this */
+    char buff[1024] = { 0 };
+    ssize_t size = ::read(fd, buff, sizeof(buff) - 1);
+    ::close(fd);
+    if (size <= 0)
+    {
+        return false;
+    }
+    buff[size] = '\0';
+
+    /*
+     * "pid (comm) state ppid ...", comm may have blanks and ')' in it,
+     * so the fields start after the last ')'
+     */
+    const char * field = strrchr(buff, ')');
+    if (nullptr == field || ' ' != field[1])
+    {
+        return false;
+    }
+    field += 2;
+
+    /* field 3 */
+    if ('Z' == *field || 'X' == *field)
+    {
+        return false;
+    }
+
+    /* from field 3 to field 22 */
+    for (size_t index = 3; index < 22; ++index)
+    {
+        field = strchr(field, ' ');
+        if (nullptr == field)
+        {
+            return false;
+        }
+        ++field;
+    }
+
+    start_time = 0;
+    for (; *field >= '0' && *field <= '9'; ++field)
+    {
+        start_time = start_time * 10 + static_cast<uint64_t>(*field - '0');
+    }
+
+    return (' ' == *field || '\0' == *field || '\n' == *field);
+}
+
+/*
+ * getdents64 gives the inode of every /proc/<pid> directory for free,
+ * the inode is given when the directory entry is built, a new process
+ * with a reused pid gets a new one, so an unchanged inode means
+ * an unchanged process and nothing in it has to be read again
+ */
+static bool list_proc_directory(int proc_fd, std::vector<std::pair<size_t, uint64_t> > & dirent_list)
+{
+    dirent_list.clear();
+
+    union
+    {
+        linux_dirent64  dirent;
+        char            buff[32768];
+    } entries;
+
+    while (true)
+    {
+        long size = ::syscall(SYS_getdents64, proc_fd, entries.buff, sizeof(entries.buff));
+        if (size < 0)
+        {
+            RUN_LOG_ERR("getdents64(%s) failed: %d", "/proc", stupid_system_error());
+            return false;
+        }
+        else if (0 == size)
+        {
+            break;
+        }
+
+        for (long offset = 0; offset < size; )
+        {
+            const linux_dirent64 * dirent = reinterpret_cast<const linux_dirent64 *>(entries.buff + offset);
+            offset += dirent->d_reclen;
+
+            if (DT_DIR != dirent->d_type && DT_UNKNOWN != dirent->d_type)
+            {
+                continue;
+            }
+
+            size_t pid = 0;
+            if (!parse_pid(dirent->d_name, pid))
+            {
+                continue;
+            }
+
+            dirent_list.push_back(std::make_pair(pid, static_cast<uint64_t>(dirent->d_ino)));
+        }
+    }
+
+    return true;
+}
+
+#endif // _MSC_VER
+
+static bool scan_all_process(process_visitor_t visitor, void * context, std::string & args_buffer)
+{
+#ifdef _MSC_VER
+    HANDLE snapshot = ::CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (INVALID_HANDLE_VALUE == snapshot)
+    {
+        RUN_LOG_ERR("CreateToolhelp32Snapshot failed: %d", stupid_system_error());
+        return false;
+    }
+
+    PROCESSENTRY32 pe = { sizeof(PROCESSENTRY32) };
+
+    for (BOOL ok = ::Process32First(snapshot, &pe); TRUE == ok; ok = Process32Next(snapshot, &pe))
+    {
+        visitor(context, static_cast<size_t>(pe.th32ProcessID), pe.szExeFile, strlen(pe.szExeFile));
+    }
+
+    ::CloseHandle(snapshot);
+
+    return true;
+#else
+    int proc_fd = ::open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (proc_fd < 0)
+    {
+        RUN_LOG_ERR("open(%s) failed: %d", "/proc", stupid_system_error());
+        return false;
+    }
+
+    /* the pid and the inode of every /proc/<pid> directory */
+    std::vector<std::pair<size_t, uint64_t> > dirent_list;
+    bool ret = list_proc_directory(proc_fd, dirent_list);
+
+    char pid_directory[32] = { 0 };
+
+    for (std::vector<std::pair<size_t, uint64_t> >::const_iterator iter = dirent_list.begin(); dirent_list.end() != iter; ++iter)
+    {
+        snprintf(pid_directory, sizeof(pid_directory), "%lu", static_cast<unsigned long>(iter->first));
+
+        /*
+         * kernel threads and zombies have an empty command line,
+         * they can never match a service, so skip them
+         */
+        if (!read_cmdline(proc_fd, pid_directory, args_buffer) || args_buffer.empty())
+        {
+            continue;
+        }
+
+        visitor(context, iter->first, args_buffer.data(), args_buffer.size());
+    }
+
+    ::close(proc_fd);
+
+    return ret;
+#endif // _MSC_VER
+}
+
+static void append_process_info(void * context, size_t pid, const char * args, size_t size)
+{
+    std::vector<PROCESS_INFO> & process_list = *reinterpret_cast<std::vector<PROCESS_INFO> *>(context);
+
+    PROCESS_INFO process_info;
+    process_info.pid = pid;
+    process_info.args.assign(args, size);
+    process_info.cmd = process_info.args;
+    std::replace(process_info.cmd.begin(), process_info.cmd.end(), '\0', ' ');
+
+    process_list.push_back(process_info);
+}
+
+bool get_all_process(std::vector<PROCESS_INFO> & process_list)
+{
+    process_list.clear();
+
+    std::string args_buffer;
+    if (!scan_all_process(append_process_info, &process_list, args_buffer))
+    {
+        process_list.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool get_process_info(size_t process_id, PROCESS_INFO & process_info)
+{
+#ifdef _MSC_VER
+    std::vector<PROCESS_INFO> process_list;
+    get_all_process(process_list);
+
+    for (std::vector<PROCESS_INFO>::const_iterator iter = process_list.begin(); process_list.end() != iter; ++iter)
+    {
+        if (iter->pid == process_id)
+        {
+            process_info = *iter;
+            return true;
+        }
+    }
+
+    return false;
+#else
+    char pid_directory[32] = { 0 };
+    snprintf(pid_directory, sizeof(pid_directory), "/proc/%lu", static_cast<unsigned long>(process_id));
+
+    process_info.pid = process_id;
+    if (!read_cmdline(AT_FDCWD, pid_directory, process_info.args) || process_info.args.empty())
+    {
+        return false;
+    }
+
+    process_info.cmd = process_info.args;
+    std::replace(process_info.cmd.begin(), process_info.cmd.end(), '\0', ' ');
+
+    return true;
+#endif // _MSC_VER
+}
+
+bool get_process_identity(size_t process_id, PROCESS_IDENTITY & process_identity)
+{
+    process_identity.pid = process_id;
+    process_identity.start_time = 0;
+
+#ifdef _MSC_VER
+    HANDLE process = ::OpenProcess(PROCESS_QUERY_INFORMATION, FALSE, static_cast<DWORD>(process_id));
+    if (nullptr == process)
+    {
+        return false;
+    }
+
+    FILETIME creation_time = { 0x00 };
+    FILETIME exit_time = { 0x00 };
+    FILETIME kernel_time = { 0x00 };
+    FILETIME user_time = { 0x00 };
+    DWORD exit_code = 0;
+    bool ret = ::GetProcessTimes(process, &creation_time, &exit_time, &kernel_time, &user_time) && ::GetExitCodeProcess(process, &exit_code) && STILL_ACTIVE == exit_code;
+    ::CloseHandle(process);
+
+    if (!ret)
+    {
+        return false;
+    }
+
+    process_identity.start_time = (static_cast<uint64_t>(creation_time.dwHighDateTime) << 32) | static_cast<uint64_t>(creation_time.dwLowDateTime);
+
+    return true;
+#else
+    char pid_directory[32] = { 0 };
+    snprintf(pid_directory, sizeof(pid_directory), "/proc/%lu", static_cast<unsigned long>(process_id));
+
+    uint64_t start_time = 0;
+    if (!read_start_time(AT_FDCWD, pid_directory, start_time))
+    {
+        return false;
+    }
+
+    process_identity.start_time = start_time;
+
+    return true;
+#endif // _MSC_VER
+}
+
+/*
+ * FNV-1a over the command line as "ps" shows it, '\0' hashes like ' '
+ */
+static uint64_t hash_command_line(const char * args, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t index = 0; index < size; ++index)
+    {
+        unsigned char c = static_cast<unsigned char>('\0' == args[index] ? ' ' : args[index]);
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t hash_process_id(size_t process_id)
+{
+    uint64_t hash = static_cast<uint64_t>(process_id) * 0x9E3779B97F4A7C15ULL;
+    return hash ^ (hash >> 29);
+}
+
+ProcessSnapshot::ProcessSnapshot()
+    : m_generation(0)
+    , m_entries()
+    , m_merge_entries()
+    , m_dirent_list()
+    , m_args_pool()
+    , m_args_buffer()
+    , m_index_mask(0)
+    , m_pid_index()
+    , m_cmd_index()
+    , m_event_stream()
+    , m_synchronized(false)
+    , m_event_list()
+    , m_born_list()
+    , m_died_list()
+{
+
+}
+
+bool ProcessSnapshot::open_event_stream()
+{
+    m_synchronized = false;
+    return m_event_stream.init();
+}
+
+void ProcessSnapshot::close_event_stream()
+{
+    m_event_stream.exit();
+    m_synchronized = false;
+}
+
+void ProcessSnapshot::append_entry(void * context, size_t pid, const char * args, size_t size)
+{
+    ProcessSnapshot & snapshot = *reinterpret_cast<ProcessSnapshot *>(context);
+
+    Entry entry;
+    entry.pid = pid;
+    entry.start_time = 0;
+    entry.inode = 0;
+    entry.cmd_hash = hash_command_line(args, size);
+    entry.args_offset = snapshot.m_args_pool.size();
+    entry.args_size = size;
+    snapshot.m_entries.push_back(entry);
+
+    snapshot.m_args_pool.append(args, size);
+}
+
+bool ProcessSnapshot::entry_pid_less(const Entry & lhs, const Entry & rhs)
+{
+    return (lhs.pid < rhs.pid);
+}
+
+bool ProcessSnapshot::rescan()
+{
+    /* entries appended by events are out of order */
+    std::sort(m_entries.begin(), m_entries.end(), &ProcessSnapshot::entry_pid_less);
+
+#ifdef _MSC_VER
+    m_merge_entries.swap(m_entries);
+
+    /* clear() keeps the capacity, so a steady process table does not allocate */
+    m_entries.clear();
+    m_args_pool.clear();
+
+    bool ret = scan_all_process(&ProcessSnapshot::append_entry, this, m_args_buffer);
+    if (!ret)
+    {
+        m_entries.clear();
+        m_args_pool.clear();
+    }
+    std::sort(m_entries.begin(), m_entries.end(), &ProcessSnapshot::entry_pid_less);
+
+    std::vector<Entry>::const_iterator iter_old = m_merge_entries.begin();
+    std::vector<Entry>::const_iterator iter_new = m_entries.begin();
+    while (m_merge_entries.end() != iter_old || m_entries.end() != iter_new)
+    {
+        if (m_entries.end() == iter_new || (m_merge_entries.end() != iter_old && iter_old->pid < iter_new->pid))
+        {
+            m_died_list.push_back((iter_old++)->pid);
+        }
+        else if (m_merge_entries.end() == iter_old || iter_new->pid < iter_old->pid)
+        {
+            m_born_list.push_back((iter_new++)->pid);
+        }
+        else
+        {
+            ++iter_old;
+            ++iter_new;
+        }
+    }
+
+    build_index();
+
+    return ret;
+#else
+    int proc_fd = ::open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (proc_fd < 0)
+    {
+        RUN_LOG_ERR("open(%s) failed: %d", "/proc", stupid_system_error());
+        return false;
+    }
+
+    if (!list_proc_directory(proc_fd, m_dirent_list))
+    {
+        ::close(proc_fd);
+        return false;
+    }
+    std::sort(m_dirent_list.begin(), m_dirent_list.end());
+
+    m_merge_entries.clear();
+
+    char pid_directory[32] = { 0 };
+
+    std::vector<Entry>::const_iterator iter_old = m_entries.begin();
+    dirent_list_t::const_iterator iter_new = m_dirent_list.begin();
+    while (m_entries.end() != iter_old || m_dirent_list.end() != iter_new)
+    {
+        if (m_dirent_list.end() == iter_new || (m_entries.end() != iter_old && iter_old->pid < iter_new->first))
+        {
+            m_died_list.push_back((iter_old++)->pid);
+            continue;
+        }
+
+        const size_t pid = iter_new->first;
+        const uint64_t inode = iter_new->second;
+        ++iter_new;
+
+        const Entry * old_entry = nullptr;
+        if (m_entries.end() != iter_old && iter_old->pid == pid)
+        {
+            old_entry = &*iter_old++;
+        }
+
+        if (nullptr != old_entry && old_entry->inode == inode)
+        {
+            m_merge_entries.push_back(*old_entry);
+            continue;
+        }
+
+        snprintf(pid_directory, sizeof(pid_directory), "%lu", static_cast<unsigned long>(pid));
+
+        /* exited while scanning, or a zombie */
+        uint64_t start_time = 0;
+        if (!read_start_time(proc_fd, pid_directory, start_time))
+        {
+            if (nullptr != old_entry)
+            {
+                m_died_list.push_back(pid);
+            }
+            continue;
+        }
+
+        /*
+         * the directory entry is only rebuilt (the dentry cache is shrunk),
+         * or the entry is added by events and the start time is not read
+         */
+        if (nullptr != old_entry && (old_entry->start_time == start_time || 0 == old_entry->start_time))
+        {
+            Entry entry = *old_entry;
+            entry.start_time = start_time;
+            entry.inode = inode;
+            m_merge_entries.push_back(entry);
+            continue;
+        }
+
+        if (!read_cmdline(proc_fd, pid_directory, m_args_buffer))
+        {
+            if (nullptr != old_entry)
+            {
+                m_died_list.push_back(pid);
+            }
+            continue;
+        }
+
+        /* the pid is reused by a new process */
+        if (nullptr != old_entry)
+        {
+            m_died_list.push_back(pid);
+        }
+        m_born_list.push_back(pid);
+
+        Entry entry;
+        entry.pid = pid;
+        entry.start_time = start_time;
+        entry.inode = inode;
+        entry.cmd_hash = hash_command_line(m_args_buffer.data(), m_args_buffer.size());
+        entry.args_offset = m_args_pool.size();
+        entry.args_size = m_args_buffer.size();
+        m_merge_entries.push_back(entry);
+
+        m_args_pool.append(m_args_buffer);
+    }
+
+    ::close(proc_fd);
+
+    m_entries.swap(m_merge_entries);
+
+    compact_args_pool();
+
+    build_index();
+
+    return true;
+#endif // _MSC_VER
+}
+
+void ProcessSnapshot::update()
+{
+    if (!m_event_stream.is_open())
+    {
+        return;
+    }
+
+    if (!m_event_stream.read(m_event_list))
+    {
+        if (m_synchronized)
+        {
+            RUN_LOG_ERR("process events lost, rescan /proc at next refresh");
+        }
+        m_synchronized = false;
+        return;
+    }
+
+    /* the stream is read empty even before the first scan, or the event loop would not sleep */
+    if (!m_synchronized)
+    {
+        m_event_list.clear();
+        return;
+    }
+
+    apply_events();
+}
+
+int ProcessSnapshot::event_fd() const
+{
+    return m_event_stream.fd();
+}
+
+bool ProcessSnapshot::refresh()
+{
+    ++m_generation;
+
+    if (m_event_stream.is_open())
+    {
+        update();
+        if (m_synchronized)
+        {
+            return true;
+        }
+
+        /*
+         * drop the queued events first, events come while scanning are
+         * applied later, applying them again is harmless
+         */
+        m_event_stream.read(m_event_list);
+        m_synchronized = rescan();
+        return m_synchronized;
+    }
+
+    return rescan();
+}
+
+void ProcessSnapshot::apply_events()
+{
+#ifndef _MSC_VER
+    if (m_event_list.empty())
+    {
+        return;
+    }
+
+    /* the last event of a pid decides: alive (fork/exec) or gone (exit) */
+    std::map<size_t, bool> event_map;
+    for (std::vector<ProcEvent>::const_iterator iter = m_event_list.begin(); m_event_list.end() != iter; ++iter)
+    {
+        event_map[iter->pid] = (ProcEvent::exit_event != iter->type);
+    }
+
+    char pid_directory[32] = { 0 };
+
+    for (std::map<size_t, bool>::const_iterator iter = event_map.begin(); event_map.end() != iter; ++iter)
+    {
+        Entry * entry = find_entry(iter->first);
+
+        bool alive = iter->second;
+        if (alive)
+        {
+            snprintf(pid_directory, sizeof(pid_directory), "/proc/%lu", static_cast<unsigned long>(iter->first));
+            alive = read_cmdline(AT_FDCWD, pid_directory, m_args_buffer) && !m_args_buffer.empty();
+        }
+
+        if (!alive)
+        {
+            if (nullptr != entry)
+            {
+                m_died_list.push_back(entry->pid);
+                entry->pid = 0; /* removed below, the index stays valid until then */
+            }
+        }
+        else if (nullptr != entry)
+        {
+            /* exec, or exit and fork again with the same pid, read the start time at next rescan */
+            entry->start_time = 0;
+            entry->cmd_hash = hash_command_line(m_args_buffer.data(), m_args_buffer.size());
+            entry->args_offset = m_args_pool.size();
+            entry->args_size = m_args_buffer.size();
+            m_args_pool.append(m_args_buffer);
+        }
+        else
+        {
+            m_born_list.push_back(iter->first);
+            append_entry(this, iter->first, m_args_buffer.data(), m_args_buffer.size());
+        }
+    }
+
+    size_t count = 0;
+    for (size_t index = 0; index < m_entries.size(); ++index)
+    {
+        if (0 != m_entries[index].pid)
+        {
+            m_entries[count++] = m_entries[index];
+        }
+    }
+    m_entries.resize(count);
+
+    compact_args_pool();
+
+    build_index();
+#endif // _MSC_VER
+}
+
+void ProcessSnapshot::compact_args_pool()
+{
+    size_t live_size = 0;
+    for (std::vector<Entry>::const_iterator iter = m_entries.begin(); m_entries.end() != iter; ++iter)
+    {
+        live_size += iter->args_size;
+    }
+
+    if (m_args_pool.size() <= live_size * 2 + 64 * 1024)
+    {
+        return;
+    }
+
+    std::string args_pool;
+    args_pool.reserve(live_size * 2);
+    for (std::vector<Entry>::iterator iter = m_entries.begin(); m_entries.end() != iter; ++iter)
+    {
+        size_t args_offset = args_pool.size();
+        args_pool.append(m_args_pool, iter->args_offset, iter->args_size);
+        iter->args_offset = args_offset;
+    }
+    m_args_pool.swap(args_pool);
+}
+
+void ProcessSnapshot::build_index()
+{
+    size_t capacity = 16;
+    while (capacity < m_entries.size() * 2)
+    {
+        capacity *= 2;
+    }
+
+    m_index_mask = capacity - 1;
+    m_pid_index.assign(capacity, 0);
+    m_cmd_index.assign(capacity, 0);
+
+    for (size_t index = 0; index < m_entries.size(); ++index)
+    {
+        const Entry & entry = m_entries[index];
+
+        size_t slot = static_cast<size_t>(hash_process_id(entry.pid)) & m_index_mask;
+        while (0 != m_pid_index[slot])
+        {
+            slot = (slot + 1) & m_index_mask;
+        }
+        m_pid_index[slot] = static_cast<uint32_t>(index + 1);
+
+        if (0 == entry.args_size)
+        {
+            continue;
+        }
+
+        slot = static_cast<size_t>(entry.cmd_hash) & m_index_mask;
+        while (0 != m_cmd_index[slot])
+        {
+            slot = (slot + 1) & m_index_mask;
+        }
+        m_cmd_index[slot] = static_cast<uint32_t>(index + 1);
+    }
+}
+
+ProcessSnapshot::Entry * ProcessSnapshot::find_entry(size_t process_id)
+{
+    return const_cast<Entry *>(static_cast<const ProcessSnapshot *>(this)->find_entry(process_id));
+}
+
+const ProcessSnapshot::Entry * ProcessSnapshot::find_entry(size_t process_id) const
+{
+    if (m_pid_index.empty())
+    {
+        return nullptr;
+    }
+
+    for (size_t slot = static_cast<size_t>(hash_process_id(process_id)) & m_index_mask; 0 != m_pid_index[slot]; slot = (slot + 1) & m_index_mask)
+    {
+        const Entry & entry = m_entries[m_pid_index[slot] - 1];
+        if (entry.pid == process_id)
+        {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+}
+
+bool ProcessSnapshot::match_entry(const Entry & entry, uint64_t cmd_hash, const std::string & process_name) const
+{
+    if (entry.cmd_hash != cmd_hash || entry.args_size != process_name.size())
+    {
+        return false;
+    }
+
+    const char * args = m_args_pool.data() + entry.args_offset;
+    for (size_t index = 0; index < entry.args_size; ++index)
+    {
+        char c = ('\0' == args[index] ? ' ' : args[index]);
+        if (c != process_name[index])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint64_t ProcessSnapshot::generation() const
+{
+    return m_generation;
+}
+
+size_t ProcessSnapshot::size() const
+{
+    return m_entries.size();
+}
+
+void ProcessSnapshot::take_changes(std::vector<size_t> & born_list, std::vector<size_t> & died_list)
+{
+    born_list.clear();
+    died_list.clear();
+    born_list.swap(m_born_list);
+    died_list.swap(m_died_list);
+}
+
+bool ProcessSnapshot::find(size_t process_id, std::string & process_name) const
+{
+    const Entry * entry = find_entry(process_id);
+    if (nullptr == entry || 0 == entry->args_size)
+    {
+        process_name.clear();
+        return false;
+    }
+
+    process_name.assign(m_args_pool, entry->args_offset, entry->args_size);
+    std::replace(process_name.begin(), process_name.end(), '\0', ' ');
+
+    return true;
+}
+
+bool ProcessSnapshot::is_alive(size_t process_id, const std::string & process_name) const
+{
+    const Entry * entry = find_entry(process_id);
+    if (nullptr == entry || 0 == entry->args_size)
+    {
+        return false;
+    }
+
+    return match_entry(*entry, hash_command_line(process_name.data(), process_name.size()), process_name);
+}
+
+bool ProcessSnapshot::is_alive(const std::string & process_name) const
+{
+    if (m_cmd_index.empty())
+    {
+        return false;
+    }
+
+    const uint64_t cmd_hash = hash_command_line(process_name.data(), process_name.size());
+
+    for (size_t slot = static_cast<size_t>(cmd_hash) & m_index_mask; 0 != m_cmd_index[slot]; slot = (slot + 1) & m_index_mask)
+    {
+        if (match_entry(m_entries[m_cmd_index[slot] - 1], cmd_hash, process_name))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
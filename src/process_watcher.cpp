@@ -0,0 +1,354 @@
+/********************************************************
+ * Description : process exit watcher of daemon
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#include "net/common/common.h"
+
+#ifdef _MSC_VER
+    #include <windows.h>
+#else
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <signal.h>
+    #include <pthread.h>
+    #include <sys/wait.h>
+    #include <sys/resource.h>
+    #include <sys/epoll.h>
+    #include <sys/signalfd.h>
+    #include <sys/syscall.h>
+#endif // _MSC_VER
+
+#include <cstdint>
+#include <cstring>
+
+#include "base/log/log.h"
+#include "process_watcher.h"
+
+#ifndef _MSC_VER
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif // SYS_pidfd_open
+
+static int pidfd_open(size_t process_id)
+{
+    return static_cast<int>(::syscall(SYS_pidfd_open, static_cast<pid_t>(process_id), 0));
+}
+
+/* pid 0 is never watched, so it marks the signalfd in the epoll set */
+static const uint64_t signal_fd_key = 0;
+
+#endif // _MSC_VER
+
+ProcessWatcher::ProcessWatcher()
+    : m_supported(false)
+    , m_epoll_fd(-1)
+    , m_signal_fd(-1)
+    , m_process_map()
+{
+
+}
+
+ProcessWatcher::~ProcessWatcher()
+{
+    exit();
+}
+
+bool ProcessWatcher::init()
+{
+    exit();
+
+#ifdef _MSC_VER
+    m_supported = true;
+#else
+    m_epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll_fd < 0)
+    {
+        RUN_LOG_ERR("epoll_create1 failed: %d", stupid_system_error());
+        return false;
+    }
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    ::pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    m_signal_fd = ::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (m_signal_fd < 0)
+    {
+        RUN_LOG_ERR("signalfd(SIGCHLD) failed: %d", stupid_system_error());
+        exit();
+        return false;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = signal_fd_key;
+    if (::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_signal_fd, &event) < 0)
+    {
+        RUN_LOG_ERR("epoll_ctl(add signalfd) failed: %d", stupid_system_error());
+        exit();
+        return false;
+    }
+
+    int pidfd = pidfd_open(static_cast<size_t>(::getpid()));
+    if (pidfd < 0)
+    {
+        RUN_LOG_ERR("pidfd_open is not supported (%d), only children exit will be found by SIGCHLD", stupid_system_error());
+        m_supported = false;
+    }
+    else
+    {
+        ::close(pidfd);
+        m_supported = true;
+    }
+#endif // _MSC_VER
+
+    return true;
+}
+
+void ProcessWatcher::exit()
+{
+    for (std::map<size_t, process_handle_t>::iterator iter = m_process_map.begin(); m_process_map.end() != iter; ++iter)
+    {
+#ifdef _MSC_VER
+        ::CloseHandle(iter->second);
+#else
+        ::close(iter->second);
+#endif // _MSC_VER
+    }
+    m_process_map.clear();
+
+#ifndef _MSC_VER
+    if (m_signal_fd >= 0)
+    {
+        ::close(m_signal_fd);
+        m_signal_fd = -1;
+    }
+
+    if (m_epoll_fd >= 0)
+    {
+        ::close(m_epoll_fd);
+        m_epoll_fd = -1;
+    }
+#endif // _MSC_VER
+
+    m_supported = false;
+}
+
+bool ProcessWatcher::watch(size_t process_id)
+{
+    if (!m_supported)
+    {
+        return false;
+    }
+
+    unwatch(process_id);
+
+#ifdef _MSC_VER
+    HANDLE process = ::OpenProcess(SYNCHRONIZE | PROCESS_QUERY_INFORMATION, FALSE, static_cast<DWORD>(process_id));
+    if (nullptr == process)
+    {
+        RUN_LOG_ERR("open process %u failed: %d", process_id, stupid_system_error());
+        return false;
+    }
+
+    m_process_map[process_id] = process;
+#else
+    /*
+     * a child which already exited is still a zombie here (the reaper only
+     * runs in wait() on the same thread), so its pidfd is valid and readable
+     */
+    int pidfd = pidfd_open(process_id);
+    if (pidfd < 0)
+    {
+        RUN_LOG_ERR("pidfd_open(%u) failed: %d", process_id, stupid_system_error());
+        return false;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = static_cast<uint64_t>(process_id);
+    if (::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, pidfd, &event) < 0)
+    {
+        RUN_LOG_ERR("epoll_ctl(add pidfd of %u) failed: %d", process_id, stupid_system_error());
+        ::close(pidfd);
+        return false;
+    }
+
+    m_process_map[process_id] = pidfd;
+#endif // _MSC_VER
+
+    return true;
+}
+
+void ProcessWatcher::unwatch(size_t process_id)
+{
+    std::map<size_t, process_handle_t>::iterator iter = m_process_map.find(process_id);
+    if (m_process_map.end() == iter)
+    {
+        return;
+    }
+
+#ifdef _MSC_VER
+    ::CloseHandle(iter->second);
+#else
+    /* closing the pidfd also removes it from the epoll set */
+    ::close(iter->second);
+#endif // _MSC_VER
+
+    m_process_map.erase(iter);
+}
+
+void ProcessWatcher::reap_children(std::vector<ProcessExit> & exit_list)
+{
+#ifndef _MSC_VER
+    while (true)
+    {
+        int status = 0;
+        struct rusage usage;
+        memset(&usage, 0, sizeof(usage));
+        pid_t pid = ::wait4(-1, &status, WNOHANG, &usage);
+        if (pid < 0 && EINTR == errno)
+        {
+            continue;
+        }
+        if (pid <= 0)
+        {
+            break; /* no more exited child (0) or no child at all (ECHILD) */
+        }
+
+        ProcessExit process_exit;
+        process_exit.pid = static_cast<size_t>(pid);
+        process_exit.reaped = true;
+        process_exit.exit_code = (WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        process_exit.signal = (WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+        process_exit.cpu_time_ms = static_cast<uint64_t>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000 + static_cast<uint64_t>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+        process_exit.max_rss = static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+        exit_list.push_back(process_exit);
+    }
+#endif // _MSC_VER
+}
+
+int ProcessWatcher::event_fd() const
+{
+    return m_epoll_fd;
+}
+
+bool ProcessWatcher::wait(int timeout_ms, std::vector<ProcessExit> & exit_list)
+{
+    exit_list.clear();
+
+#ifdef _MSC_VER
+    for (std::map<size_t, process_handle_t>::const_iterator iter = m_process_map.begin(); m_process_map.end() != iter; ++iter)
+    {
+        if (WAIT_OBJECT_0 == ::WaitForSingleObject(iter->second, 0))
+        {
+            DWORD exit_code = 0;
+            ::GetExitCodeProcess(iter->second, &exit_code);
+
+            FILETIME creation_time = { 0x00 };
+            FILETIME exit_time = { 0x00 };
+            FILETIME kernel_time = { 0x00 };
+            FILETIME user_time = { 0x00 };
+            ::GetProcessTimes(iter->second, &creation_time, &exit_time, &kernel_time, &user_time);
+
+            ProcessExit process_exit;
+            process_exit.pid = iter->first;
+            process_exit.reaped = true;
+            process_exit.exit_code = static_cast<int>(exit_code);
+            process_exit.signal = 0;
+            process_exit.cpu_time_ms = ((static_cast<uint64_t>(kernel_time.dwHighDateTime) << 32 | kernel_time.dwLowDateTime) + (static_cast<uint64_t>(user_time.dwHighDateTime) << 32 | user_time.dwLowDateTime)) / 10000;
+            process_exit.max_rss = 0;
+            exit_list.push_back(process_exit);
+        }
+    }
+#else
+    if (m_epoll_fd < 0)
+    {
+        return false;
+    }
+
+    const int max_events = 64;
+    struct epoll_event events[max_events];
+
+    int count = ::epoll_wait(m_epoll_fd, events, max_events, timeout_ms);
+    if (count < 0)
+    {
+        if (EINTR == stupid_system_error())
+        {
+            return true;
+        }
+        RUN_LOG_ERR("epoll_wait failed: %d", stupid_system_error());
+        return false;
+    }
+
+    if (0 == count)
+    {
+        return true;
+    }
+
+    std::vector<size_t> pidfd_ready_list;
+
+    for (int index = 0; index < count; ++index)
+    {
+        if (signal_fd_key == events[index].data.u64)
+        {
+            struct signalfd_siginfo siginfo;
+            while (::read(m_signal_fd, &siginfo, sizeof(siginfo)) == static_cast<ssize_t>(sizeof(siginfo)))
+            {
+                /* SIGCHLD may be merged, so the siginfo is not used, reap all below */
+            }
+        }
+        else
+        {
+            pidfd_ready_list.push_back(static_cast<size_t>(events[index].data.u64));
+        }
+    }
+
+    reap_children(exit_list);
+
+    /*
+     * a watched process which is not our child can not be reaped here,
+     * it is reported without exit status
+     */
+    for (std::vector<size_t>::const_iterator iter = pidfd_ready_list.begin(); pidfd_ready_list.end() != iter; ++iter)
+    {
+        bool reaped = false;
+        for (std::vector<ProcessExit>::const_iterator iter_exit = exit_list.begin(); exit_list.end() != iter_exit; ++iter_exit)
+        {
+            if (iter_exit->pid == *iter)
+            {
+                reaped = true;
+                break;
+            }
+        }
+        if (!reaped)
+        {
+            ProcessExit process_exit;
+            process_exit.pid = *iter;
+            process_exit.reaped = false;
+            process_exit.exit_code = -1;
+            process_exit.signal = 0;
+            process_exit.cpu_time_ms = 0;
+            process_exit.max_rss = 0;
+            exit_list.push_back(process_exit);
+        }
+    }
+#endif // _MSC_VER
+
+    for (std::vector<ProcessExit>::const_iterator iter = exit_list.begin(); exit_list.end() != iter; ++iter)
+    {
+        unwatch(iter->pid);
+    }
+
+    return true;
+}
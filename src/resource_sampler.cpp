@@ -0,0 +1,430 @@
+/********************************************************
+ * Description : resource sampler of daemon services
+ * Data        : 2026-10-18 09:30:00
+ * Author      : yanrk
+ * Email       : yanrkchina@hotmail.com
+ * Blog        : blog.csdn.net/cxxmaker
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2015 - 2026
+ ********************************************************/
+
+#include "net/common/common.h"
+
+#ifdef _MSC_VER
+    #include <windows.h>
+#else
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <dirent.h>
+    #include <sys/stat.h>
+    #include <sys/syscall.h>
+#endif // _MSC_VER
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "base/log/log.h"
+#include "resource_sampler.h"
+#include "utility.h"
+
+#ifndef _MSC_VER
+
+struct linux_dirent64
+{
+    uint64_t        d_ino;
+    int64_t         d_off;
+    unsigned short  d_reclen;
+    unsigned char   d_type;
+    char            d_name[1];
+};
+
+static int open_file(const char * directory, const char * file_name, int flags)
+{
+    char path[512] = { 0 };
+    snprintf(path, sizeof(path), "%s/%s", directory, file_name);
+    return ::open(path, flags | O_CLOEXEC);
+}
+
+static void close_file(int & fd)
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+static uint64_t parse_number(const char * field)
+{
+    return static_cast<uint64_t>(strtoull(field, nullptr, 10));
+}
+
+#endif // _MSC_VER
+
+ResourceSampler::ResourceSampler()
+    : m_interval_ms(0)
+    , m_history_size(0)
+    , m_next_sample_ms(0)
+    , m_clock_ticks(100)
+    , m_page_size(4096)
+    , m_track_map()
+{
+    m_buffer[0] = '\0';
+}
+
+ResourceSampler::~ResourceSampler()
+{
+    exit();
+}
+
+void ResourceSampler::init(uint64_t interval_ms, size_t history_size)
+{
+    exit();
+
+    m_interval_ms = interval_ms;
+    m_history_size = (history_size > 0 ? history_size : 1);
+    m_next_sample_ms = 0;
+
+#ifndef _MSC_VER
+    long clock_ticks = ::sysconf(_SC_CLK_TCK);
+    m_clock_ticks = (clock_ticks > 0 ? static_cast<uint64_t>(clock_ticks) : 100);
+    long page_size = ::sysconf(_SC_PAGESIZE);
+    m_page_size = (page_size > 0 ? static_cast<uint64_t>(page_size) : 4096);
+#endif // _MSC_VER
+}
+
+void ResourceSampler::exit()
+{
+    for (std::map<std::string, Track>::iterator iter = m_track_map.begin(); m_track_map.end() != iter; ++iter)
+    {
+        close_track(iter->second);
+    }
+    m_track_map.clear();
+    m_interval_ms = 0;
+}
+
+void ResourceSampler::track(const std::string & service, size_t process_id, const std::string & cgroup_path)
+{
+    if (0 == m_interval_ms)
+    {
+        return;
+    }
+
+    Track & track = m_track_map[service];
+    if (track.ring.empty())
+    {
+        ResourceSample empty_sample = { 0 };
+        track.ring.assign(m_history_size, empty_sample);
+        track.ring_head = 0;
+        track.ring_count = 0;
+        track.stat_fd = -1;
+        track.statm_fd = -1;
+        track.fd_dir_fd = -1;
+        track.cpu_stat_fd = -1;
+        track.memory_fd = -1;
+        track.process = nullptr;
+    }
+    else
+    {
+        close_track(track);
+    }
+
+    track.pid = process_id;
+    track.last_cpu_time_ms = 0;
+    track.last_time_ms = 0;
+
+#ifdef _MSC_VER
+    track.process = ::OpenProcess(PROCESS_QUERY_INFORMATION | SYNCHRONIZE, FALSE, static_cast<DWORD>(process_id));
+#else
+    char pid_directory[32] = { 0 };
+    snprintf(pid_directory, sizeof(pid_directory), "/proc/%lu", static_cast<unsigned long>(process_id));
+
+    /* an fd of /proc/<pid> belongs to that process, a reused pid never reads through it */
+    track.stat_fd = open_file(pid_directory, "stat", O_RDONLY);
+    track.statm_fd = open_file(pid_directory, "statm", O_RDONLY);
+    track.fd_dir_fd = open_file(pid_directory, "fd", O_RDONLY | O_DIRECTORY);
+
+    if (!cgroup_path.empty())
+    {
+        track.cpu_stat_fd = open_file(cgroup_path.c_str(), "cpu.stat", O_RDONLY);
+        track.memory_fd = open_file(cgroup_path.c_str(), "memory.current", O_RDONLY);
+    }
+
+    if (track.stat_fd < 0)
+    {
+        RUN_LOG_ERR("open %s/stat failed: %d", pid_directory, stupid_system_error());
+    }
+#endif // _MSC_VER
+}
+
+void ResourceSampler::untrack(const std::string & service, const ProcessExit & process_exit)
+{
+    std::map<std::string, Track>::iterator iter = m_track_map.find(service);
+    if (m_track_map.end() == iter || iter->second.pid != process_exit.pid)
+    {
+        return;
+    }
+
+    Track & track = iter->second;
+
+    if (process_exit.reaped)
+    {
+        const uint64_t now_ms = get_monotonic_milliseconds();
+
+        ResourceSample resource_sample = { 0 };
+        resource_sample.time_ms = now_ms;
+        resource_sample.cpu_time_ms = process_exit.cpu_time_ms;
+        if (0 != track.last_time_ms && now_ms > track.last_time_ms && process_exit.cpu_time_ms >= track.last_cpu_time_ms && track.cpu_stat_fd < 0)
+        {
+            resource_sample.cpu_usage = static_cast<uint32_t>((process_exit.cpu_time_ms - track.last_cpu_time_ms) * 1000 / (now_ms - track.last_time_ms));
+        }
+        resource_sample.rss = process_exit.max_rss;
+        resource_sample.exited = true;
+        push_sample(track, resource_sample);
+    }
+
+    close_track(track);
+    track.pid = 0;
+}
+
+void ResourceSampler::sample(uint64_t now_ms)
+{
+    if (0 == m_interval_ms || now_ms < m_next_sample_ms)
+    {
+        return;
+    }
+    m_next_sample_ms = now_ms + m_interval_ms;
+
+    for (std::map<std::string, Track>::iterator iter = m_track_map.begin(); m_track_map.end() != iter; ++iter)
+    {
+        Track & track = iter->second;
+        if (0 == track.pid)
+        {
+            continue;
+        }
+
+        ResourceSample resource_sample;
+        if (sample_track(track, now_ms, resource_sample))
+        {
+            push_sample(track, resource_sample);
+        }
+    }
+}
+
+uint64_t ResourceSampler::next_sample_time() const
+{
+    return ((0 == m_interval_ms || m_track_map.empty()) ? UINT64_MAX : m_next_sample_ms);
+}
+
+bool ResourceSampler::get_latest(const std::string & service, ResourceSample & resource_sample) const
+{
+    std::map<std::string, Track>::const_iterator iter = m_track_map.find(service);
+    if (m_track_map.end() == iter || 0 == iter->second.ring_count)
+    {
+        return false;
+    }
+
+    const Track & track = iter->second;
+    resource_sample = track.ring[(track.ring_head + track.ring.size() - 1) % track.ring.size()];
+
+    return true;
+}
+
+void ResourceSampler::get_history(const std::string & service, std::vector<ResourceSample> & sample_list) const
+{
+    sample_list.clear();
+
+    std::map<std::string, Track>::const_iterator iter = m_track_map.find(service);
+    if (m_track_map.end() == iter)
+    {
+        return;
+    }
+
+    /* oldest first */
+    const Track & track = iter->second;
+    for (size_t index = 0; index < track.ring_count; ++index)
+    {
+        sample_list.push_back(track.ring[(track.ring_head + track.ring.size() - track.ring_count + index) % track.ring.size()]);
+    }
+}
+
+bool ResourceSampler::sample_track(Track & track, uint64_t now_ms, ResourceSample & resource_sample)
+{
+    memset(&resource_sample, 0, sizeof(resource_sample));
+    resource_sample.time_ms = now_ms;
+
+#ifdef _MSC_VER
+    if (nullptr == track.process || WAIT_OBJECT_0 == ::WaitForSingleObject(track.process, 0))
+    {
+        return false;
+    }
+
+    FILETIME creation_time = { 0x00 };
+    FILETIME exit_time = { 0x00 };
+    FILETIME kernel_time = { 0x00 };
+    FILETIME user_time = { 0x00 };
+    if (!::GetProcessTimes(track.process, &creation_time, &exit_time, &kernel_time, &user_time))
+    {
+        return false;
+    }
+    resource_sample.cpu_time_ms = ((static_cast<uint64_t>(kernel_time.dwHighDateTime) << 32 | kernel_time.dwLowDateTime) + (static_cast<uint64_t>(user_time.dwHighDateTime) << 32 | user_time.dwLowDateTime)) / 10000;
+
+    DWORD handle_count = 0;
+    if (::GetProcessHandleCount(track.process, &handle_count))
+    {
+        resource_sample.fds = static_cast<uint32_t>(handle_count);
+    }
+#else
+    if (!read_file(track.stat_fd))
+    {
+        return false; /* exited, the exit event comes soon */
+    }
+
+    /*
+     * "pid (comm) state ppid ...", comm may have blanks and ')' in it,
+     * field 14 is utime, 15 is stime, 20 is num_threads
+     */
+    const char * field = strrchr(m_buffer, ')');
+    if (nullptr == field)
+    {
+        return false;
+    }
+    ++field;
+
+    uint64_t utime = 0;
+    uint64_t stime = 0;
+    for (size_t index = 3; index <= 20 && nullptr != field; ++index)
+    {
+        field = strchr(field, ' ');
+        if (nullptr == field)
+        {
+            break;
+        }
+        ++field;
+
+        if (14 == index)
+        {
+            utime = parse_number(field);
+        }
+        else if (15 == index)
+        {
+            stime = parse_number(field);
+        }
+        else if (20 == index)
+        {
+            resource_sample.threads = static_cast<uint32_t>(parse_number(field));
+        }
+    }
+    resource_sample.cpu_time_ms = (utime + stime) * 1000 / m_clock_ticks;
+
+    /* the cgroup counts the whole tree of the service */
+    if (track.cpu_stat_fd >= 0 && read_file(track.cpu_stat_fd))
+    {
+        const char * usage = strstr(m_buffer, "usage_usec ");
+        if (nullptr != usage)
+        {
+            resource_sample.cpu_time_ms = parse_number(usage + 11) / 1000;
+        }
+    }
+
+    if (track.memory_fd >= 0 && read_file(track.memory_fd))
+    {
+        resource_sample.rss = parse_number(m_buffer);
+    }
+    else if (track.statm_fd >= 0 && read_file(track.statm_fd))
+    {
+        const char * resident = strchr(m_buffer, ' ');
+        if (nullptr != resident)
+        {
+            resource_sample.rss = parse_number(resident + 1) * m_page_size;
+        }
+    }
+
+    /*
+     * since linux 6.2, the size of /proc/<pid>/fd is the number of open files,
+     * before that it is 0 and the directory is counted
+     */
+    if (track.fd_dir_fd >= 0)
+    {
+        struct stat fd_dir_stat;
+        if (0 == ::fstat(track.fd_dir_fd, &fd_dir_stat) && fd_dir_stat.st_size > 0)
+        {
+            resource_sample.fds = static_cast<uint32_t>(fd_dir_stat.st_size);
+        }
+        else if (::lseek(track.fd_dir_fd, 0, SEEK_SET) >= 0)
+        {
+            uint32_t count = 0;
+            long size = 0;
+            while ((size = ::syscall(SYS_getdents64, track.fd_dir_fd, m_buffer, sizeof(m_buffer))) > 0)
+            {
+                for (long offset = 0; offset < size; )
+                {
+                    const linux_dirent64 * dirent = reinterpret_cast<const linux_dirent64 *>(m_buffer + offset);
+                    offset += dirent->d_reclen;
+                    if ('.' != dirent->d_name[0])
+                    {
+                        ++count;
+                    }
+                }
+            }
+            resource_sample.fds = count;
+        }
+    }
+#endif // _MSC_VER
+
+    if (0 != track.last_time_ms && now_ms > track.last_time_ms && resource_sample.cpu_time_ms >= track.last_cpu_time_ms)
+    {
+        resource_sample.cpu_usage = static_cast<uint32_t>((resource_sample.cpu_time_ms - track.last_cpu_time_ms) * 1000 / (now_ms - track.last_time_ms));
+    }
+    track.last_cpu_time_ms = resource_sample.cpu_time_ms;
+    track.last_time_ms = now_ms;
+
+    return true;
+}
+
+bool ResourceSampler::read_file(int fd)
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    /* a /proc or cgroup file is made again on every read from the beginning */
+    ssize_t size = ::pread(fd, m_buffer, sizeof(m_buffer) - 1, 0);
+    if (size <= 0)
+    {
+        m_buffer[0] = '\0';
+        return false;
+    }
+    m_buffer[size] = '\0';
+    return true;
+#endif // _MSC_VER
+}
+
+void ResourceSampler::close_track(Track & track)
+{
+#ifdef _MSC_VER
+    if (nullptr != track.process)
+    {
+        ::CloseHandle(track.process);
+        track.process = nullptr;
+    }
+#else
+    close_file(track.stat_fd);
+    close_file(track.statm_fd);
+    close_file(track.fd_dir_fd);
+    close_file(track.cpu_stat_fd);
+    close_file(track.memory_fd);
+#endif // _MSC_VER
+}
+
+void ResourceSampler::push_sample(Track & track, const ResourceSample & resource_sample)
+{
+    track.ring[track.ring_head] = resource_sample;
+    track.ring_head = (track.ring_head + 1) % track.ring.size();
+    if (track.ring_count < track.ring.size())
+    {
+        track.ring_count += 1;
+    }
+}
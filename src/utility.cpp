@@ -13,12 +13,12 @@
 
 #ifdef _MSC_VER
     #include <windows.h>
-    #include <tlhelp32.h>
 #else
     #include <errno.h>
     #include <fcntl.h>
     #include <unistd.h>
     #include <signal.h>
+    #include <time.h>
     #include <sys/wait.h>
     #include <cstdio>
     #include <cstdlib>
@@ -34,6 +34,9 @@
 #include "base/string/string.h"
 #include "base/filesystem/directory.h"
 #include "base/utility/utility.h"
+#include "process_table.h"
+#include "process_launcher.h"
+#include "cpu_topology.h"
 #include "utility.h"
 
 bool exclusive_init(const char * exclusive_unique_name, size_t & unique_id)
@@ -151,101 +154,7 @@ void exclusive_exit(size_t & unique_id)
 #endif // _MSC_VER
 }
 
-struct PROCESS_INFO
-{
-    size_t        pid;  /* process id   */
-    std::string   cmd;  /* command line */
-};
-
-static bool get_all_process(std::list<PROCESS_INFO> & process_list)
-{
-    process_list.clear();
-
-#ifdef _MSC_VER
-    HANDLE snapshot = ::CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-    if (INVALID_HANDLE_VALUE == snapshot)
-    {
-        RUN_LOG_ERR("CreateToolhelp32Snapshot failed: %d", stupid_system_error());
-        return false;
-    }
-
-    PROCESSENTRY32 pe = { sizeof(PROCESSENTRY32) };
-
-    for (BOOL ok = ::Process32First(snapshot, &pe); TRUE == ok; ok = Process32Next(snapshot, &pe))
-    {
-        PROCESS_INFO process_info;
-        process_info.pid = static_cast<size_t>(pe.th32ProcessID);
-        process_info.cmd = pe.szExeFile;
-        process_list.push_back(process_info);
-    }
-
-    ::CloseHandle(snapshot);
-#else
-    const char * command = "ps -eo pid,cmd";
-    FILE * file = ::popen(command, "r");
-    if (nullptr == file)
-    {
-        RUN_LOG_ERR("popen(%s) failed: %d", command, stupid_system_error());
-        return false;
-    }
-
-    const std::string spaces(" ");
-    const size_t buff_size = 2048;
-    char buff[buff_size] = { 0 };
-    while (nullptr != ::fgets(buff, buff_size, file))
-    {
-        std::string line(buff);
-
-        PROCESS_INFO process_info;
-
-        std::string::size_type pid_b = line.find_first_not_of(spaces, 0);
-        if (std::string::npos == pid_b)
-        {
-            continue;
-        }
-        std::string::size_type pid_e = line.find_first_of(spaces, pid_b);
-        if (std::string::npos == pid_e)
-        {
-            continue;
-        }
-        std::string pid_value(line.begin() + pid_b, line.begin() + pid_e);
-        if (!Stupid::Base::stupid_string_to_type(pid_value, process_info.pid))
-        {
-            continue;
-        }
-
-        std::string command_line(line.begin() + pid_e, line.end());
-        Stupid::Base::stupid_string_trim(command_line);
-        command_line.swap(process_info.cmd);
-
-        process_list.push_back(process_info);
-    }
-
-    ::pclose(file);
-#endif // _MSC_VER
-
-    return true;
-}
-
-static bool get_process_name(size_t process_id, std::string & process_name)
-{
-    std::list<PROCESS_INFO> process_list;
-    get_all_process(process_list);
-
-    for (std::list<PROCESS_INFO>::const_iterator iter = process_list.begin(); process_list.end() != iter; ++iter)
-    {
-        if (iter->pid == process_id)
-        {
-            process_name = iter->cmd;
-            return true;
-        }
-    }
-
-    process_name.clear();
-    return false;
-}
-
-bool create_process(const std::string & path, const std::string & command_line, bool show_window, size_t & process_id, std::string & process_name)
+bool create_process(const LaunchSpec & launch_spec, const std::string & command_line, bool show_window, int cgroup_procs_fd, bool limits_in_cgroup, PROCESS_IDENTITY & process_identity, bool & in_cgroup)
 {
     if (command_line.empty())
     {
@@ -254,6 +163,9 @@ bool create_process(const std::string & path, const std::string & command_line,
 
     RUN_LOG_DBG("try to create process with command line: {%s}", command_line.c_str());
 
+    size_t process_id = 0;
+    in_cgroup = false;
+
 #ifdef _MSC_VER
     STARTUPINFOA si = { sizeof(STARTUPINFOA) };
     PROCESS_INFORMATION pi = { 0x00 };
@@ -270,159 +182,121 @@ bool create_process(const std::string & path, const std::string & command_line,
 
     process_id = static_cast<size_t>(pi.dwProcessId);
 #else
-    const size_t argc = 1;
-    const char * argv[argc + 1] = { command_line.c_str(), nullptr };
-
-    pid_t pid = ::fork();
-    if (pid < 0)
+    if (launch_spec.empty())
     {
-        RUN_LOG_ERR("fork failed: command(%s), errno(%d)", command_line.c_str(), stupid_system_error());
+        RUN_LOG_ERR("launch spec is empty: command(%s)", command_line.c_str());
         return false;
     }
-    else if (0 == pid)
-    {
-        if (!Stupid::Base::stupid_set_current_work_directory(path))
-        {
-            RUN_LOG_ERR("set current work directory(%s) failed for command(%s)", path.c_str(), command_line.c_str());
-        }
-        ::close(STDIN_FILENO);
-        ::close(STDOUT_FILENO);
-        ::close(STDERR_FILENO);
-        /*
-         * if execv() success, will not execute the next exit()
-         */
-        if (::execv(argv[0], const_cast<char **>(argv)) < 0)
-        {
-            RUN_LOG_ERR("execv failed: command(%s), errno(%d)", command_line.c_str(), stupid_system_error());
-            ::exit(201); // should not be here
-        }
-        ::exit(202); // should never be here
-    }
 
-    process_id = static_cast<size_t>(pid);
-#endif // _MSC_VER
+    SpawnAttributes attributes;
+    attributes.file = launch_spec.file();
+    attributes.argv = launch_spec.argv();
+    attributes.envp = launch_spec.envp();
+    attributes.work_directory = launch_spec.work_directory();
+    attributes.close_stdio = true;
+    attributes.new_process_group = true;
+    attributes.cgroup_procs_fd = cgroup_procs_fd;
+    attributes.limits = (launch_spec.limits().empty() ? nullptr : &launch_spec.limits()[0]);
+    attributes.limit_count = launch_spec.limits().size();
+    attributes.limits_in_cgroup = limits_in_cgroup;
+    attributes.scheduling = launch_spec.scheduling();
+
+    SpawnResult result;
+    if (!spawn_process(attributes, result))
+    {
+        RUN_LOG_ERR("%s failed: command(%s), errno(%d)", result.error_step, command_line.c_str(), result.error);
+        return false;
+    }
 
-    if (!get_process_name(process_id, process_name))
+    if (0 != result.chdir_error)
     {
-        RUN_LOG_ERR("get process name failed");
+        RUN_LOG_ERR("set current work directory(%s) failed for command(%s), errno(%d)", launch_spec.work_directory(), command_line.c_str(), result.chdir_error);
     }
 
-    RUN_LOG_DBG("create process success with command line: {%s}", command_line.c_str());
+    if (0 != result.cgroup_error)
+    {
+        RUN_LOG_ERR("join cgroup failed for command(%s), errno(%d)", command_line.c_str(), result.cgroup_error);
+    }
 
-    return true;
-}
+    process_id = result.pid;
+    in_cgroup = (cgroup_procs_fd >= 0 && 0 == result.cgroup_error);
 
-static bool process_is_alive(const std::list<PROCESS_INFO> & process_list, size_t process_id, const std::string & process_name)
-{
-    for (std::list<PROCESS_INFO>::const_iterator iter = process_list.begin(); process_list.end() != iter; ++iter)
+    /*
+     * the kernel keeps only the cpus the cpuset of the process allows,
+     * so the mask which is set may not be the mask which is in effect
+     */
+    if (nullptr != attributes.scheduling && attributes.scheduling->set_cpus)
     {
-        if (iter->pid == process_id)
+        std::vector<size_t> cpus;
+        if (get_process_cpus(process_id, cpus))
         {
-            return iter->cmd == process_name;
+            std::vector<size_t> expected_cpus;
+            for (size_t cpu = 0; cpu < SpawnScheduling::mask_words * 64; ++cpu)
+            {
+                if (0 != (attributes.scheduling->cpu_mask[cpu / 64] & (static_cast<uint64_t>(1) << (cpu % 64))))
+                {
+                    expected_cpus.push_back(cpu);
+                }
+            }
+            if (cpus != expected_cpus)
+            {
+                RUN_LOG_ERR("process %u of command(%s) runs on %u cpus, not the %u cpus configured", process_id, command_line.c_str(), cpus.size(), expected_cpus.size());
+            }
         }
     }
-    return false;
-}
+#endif // _MSC_VER
 
-static bool kill_process(size_t process_id, size_t exit_code = 9)
-{
-    if (0 == process_id)
+    /*
+     * the start time is set before the process runs,
+     * unlike the command line, it can be read at once
+     */
+    if (!get_process_identity(process_id, process_identity))
     {
-        return true;
+        process_identity.pid = process_id;
+        process_identity.start_time = 0;
+        RUN_LOG_ERR("get process identity failed, process %u may be exited", process_id);
     }
 
-    if (Stupid::Base::get_pid() == process_id)
-    {
-        RUN_LOG_CRI("kill process exception: why do you kill current process?");
-        return true;
-    }
+    RUN_LOG_DBG("create process success with command line: {%s}", command_line.c_str());
 
-#ifdef _MSC_VER
-    HANDLE process = ::OpenProcess(PROCESS_ALL_ACCESS, FALSE, static_cast<DWORD>(process_id));
-    if (nullptr == process)
-    {
-        RUN_LOG_ERR("open process %u failed: %d", process_id, stupid_system_error());
-        return false;
-    }
-    if (!::TerminateProcess(process, exit_code))
-    {
-        RUN_LOG_ERR("kill process %u failed: %d", process_id, stupid_system_error());
-        return false;
-    }
-#else
-    pid_t pid = static_cast<pid_t>(process_id);
-    if (::kill(pid, SIGKILL) < 0)
-    {
-        RUN_LOG_ERR("kill process %u failed: %d", process_id, stupid_system_error());
-    }
-    if (::waitpid(pid, nullptr, 0) != pid)
-    {
-        RUN_LOG_ERR("wait process %u failed: %d", process_id, stupid_system_error());
-    }
-#endif // _MSC_VER
     return true;
 }
 
-bool kill_process(size_t process_id, const std::string & process_name)
+bool is_process_alive(const ProcessSnapshot & process_snapshot, const std::string & process_name)
 {
-    if (Stupid::Base::get_pid() == process_id || 0 == process_id)
-    {
-        return true;
-    }
-
-    RUN_LOG_DBG("kill process: [%u:%s] begin", process_id, process_name.c_str());
+    return process_snapshot.is_alive(process_name);
+}
 
-    bool ret = false;
-    do
+bool is_process_alive(const PROCESS_IDENTITY & process_identity)
+{
+    PROCESS_IDENTITY current_identity;
+    if (!get_process_identity(process_identity.pid, current_identity))
     {
-        std::list<PROCESS_INFO> process_list;
-        get_all_process(process_list);
-
-        if (!process_is_alive(process_list, process_id, process_name))
-        {
-            RUN_LOG_DBG("process [%u:%s] is not exist", process_id, process_name.c_str());
-            ret = true;
-            break;
-        }
-
-        if (kill_process(process_id))
-        {
-            RUN_LOG_DBG("kill process %u success", process_id);
-        }
-        else
-        {
-            RUN_LOG_ERR("kill process %u failure", process_id);
-        }
-
-        process_list.clear();
-        get_all_process(process_list);
-
-        if (process_is_alive(process_list, process_id, process_name))
-        {
-            RUN_LOG_DBG("process [%u:%s] is still exist", process_id, process_name.c_str());
-            break;
-        }
-
-        ret = true;
-    } while (false);
-
-    RUN_LOG_DBG("kill process: [%u:%s] end", process_id, process_name.c_str());
+        return false;
+    }
 
-    return ret;
+    return (current_identity.start_time == process_identity.start_time);
 }
 
-bool is_process_alive(const std::string & process_name)
+uint64_t get_monotonic_milliseconds()
 {
-    std::list<PROCESS_INFO> process_list;
-    get_all_process(process_list);
+    return (get_monotonic_nanoseconds() / 1000000);
+}
 
-    for (std::list<PROCESS_INFO>::const_iterator iter = process_list.begin(); process_list.end() != iter; ++iter)
+uint64_t get_monotonic_nanoseconds()
+{
+#ifdef _MSC_VER
+    static LARGE_INTEGER frequency = { 0x00 };
+    if (0 == frequency.QuadPart)
     {
-        if (iter->cmd == process_name)
-        {
-            return true;
-        }
+        ::QueryPerformanceFrequency(&frequency);
     }
-
-    return false;
+    LARGE_INTEGER counter = { 0x00 };
+    ::QueryPerformanceCounter(&counter);
+    return (static_cast<uint64_t>(counter.QuadPart / frequency.QuadPart) * 1000000000 + static_cast<uint64_t>(counter.QuadPart % frequency.QuadPart) * 1000000000 / static_cast<uint64_t>(frequency.QuadPart));
+#else
+    struct timespec now;
+    ::clock_gettime(CLOCK_MONOTONIC, &now);
+    return (static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec));
+#endif // _MSC_VER
 }